@@ -0,0 +1,93 @@
+#!/bin/sh
+# Compare the wall time of `make check -jN` and pincheck on the same pintos
+# project, repeated and interleaved, and print medians and spread.
+#
+# usage: bench/compare.sh <pincheck> <project dir> [repeats]
+#   e.g. bench/compare.sh build/pincheck ~/pintos-kaist/src/threads 5
+#
+# Tunables (environment):
+#   COMPARE_JOBS  values of -j to try                       (default "2 4")
+#   COMPARE_SETS  extra pincheck option sets, comma-separated (default ",--order history")
+#                 an empty set means plain pincheck -j N
+#   COMPARE_OUT   directory for samples and logs            (default compare_out)
+#
+# Test outputs are removed before every run, so that make reruns them.
+# Discovery is warmed up once by `pincheck --simulate`, so cache.pincheck
+# exists for every measured pincheck run, as it does in daily use.
+
+set -e
+
+PINCHECK=$(cd "$(dirname "${1:?usage: compare.sh <pincheck> <project dir> [repeats]}")" && pwd)/$(basename "$1")
+PROJECT=$(cd "${2:?usage: compare.sh <pincheck> <project dir> [repeats]}" && pwd)
+REPEATS=${3:-3}
+JOBS=${COMPARE_JOBS:-"2 4"}
+SETS=${COMPARE_SETS-",--order history"}
+OUT=${COMPARE_OUT:-compare_out}
+
+mkdir -p "$OUT"
+OUT=$(cd "$OUT" && pwd)
+SAMPLES="$OUT/samples.csv"
+echo "command,repeat,seconds,passed" > "$SAMPLES"
+
+now() {
+  date +%s.%N
+}
+
+clean_outputs() {
+  find "$PROJECT/build/tests" \( -name '*.output' -o -name '*.result' -o -name '*.errors' \) \
+    -exec rm -f {} + 2> /dev/null || true
+}
+
+count_passed() {
+  find "$PROJECT/build/tests" -name '*.result' -exec head -n 1 {} + 2> /dev/null | grep -c '^PASS' || true
+}
+
+# measure <label> <repeat> <command...>
+measure() {
+  label=$1; rep=$2; shift 2
+  clean_outputs
+  start=$(now)
+  (cd "$PROJECT" && "$@") > "$OUT/last.log" 2>&1 || true
+  end=$(now)
+  echo "$label,$rep,$(echo "$start $end" | awk '{ printf "%.2f", $2 - $1 }'),$(count_passed)" >> "$SAMPLES"
+}
+
+make -C "$PROJECT" > /dev/null
+(cd "$PROJECT" && "$PINCHECK" -nv --simulate > /dev/null 2>&1) || true
+
+for rep in $(seq 1 "$REPEATS"); do
+  echo "repeat $rep of $REPEATS..." >&2
+  for j in $JOBS; do
+    measure "make check -j $j" "$rep" make -C build check -j "$j"
+    echo "$SETS" | tr ',' '\n' | while IFS= read -r set; do
+      # shellcheck disable=SC2086
+      measure "$(echo "pincheck -j $j $set" | sed 's/ *$//')" "$rep" "$PINCHECK" -nv -j "$j" $set
+    done
+  done
+done
+
+echo
+awk -F, 'NR > 1 {
+    if (!($1 in n)) order[++count] = $1
+    x[$1, ++n[$1]] = $3; sum[$1] += $3; pass[$1] = (pass[$1] == "" || $4 < pass[$1]) ? $4 : pass[$1]
+  }
+  END {
+    printf "%-36s %3s %8s %8s %8s %6s %8s %8s %6s\n", "command", "n", "median", "mean", "stddev", "cv", "min", "max", "pass"
+    for (k = 1; k <= count; ++k) {
+      c = order[k]; m = n[c]
+      # insertion sort of the samples
+      for (i = 2; i <= m; ++i) {
+        v = x[c, i]
+        for (j = i - 1; j >= 1 && x[c, j] > v; --j) x[c, j + 1] = x[c, j]
+        x[c, j + 1] = v
+      }
+      median = (m % 2) ? x[c, (m + 1) / 2] : (x[c, m / 2] + x[c, m / 2 + 1]) / 2
+      mean = sum[c] / m
+      ss = 0
+      for (i = 1; i <= m; ++i) ss += (x[c, i] - mean) ^ 2
+      sd = m > 1 ? sqrt(ss / (m - 1)) : 0
+      printf "%-36s %3d %8.2f %8.2f %8.2f %5.1f%% %8.2f %8.2f %6d\n", c, m, median, mean, sd, (mean > 0 ? 100 * sd / mean : 0), x[c, 1], x[c, m], pass[c]
+    }
+  }' "$SAMPLES"
+echo
+echo "pass is the fewest passing tests of any repeat. Samples are kept in $SAMPLES"
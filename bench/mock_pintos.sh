@@ -0,0 +1,198 @@
+#!/bin/sh
+# Generate a synthetic pintos-kaist-like tree that pincheck can drive
+# without qemu. Every "kernel" is a shell sleep with a configurable
+# duration, result and statistics footer.
+#
+# usage: bench/mock_pintos.sh <dest> [tests] [seed]
+#
+# Tunables (environment):
+#   MOCK_MEAN   mean test duration in seconds   (default 0.5)
+#   MOCK_LONG   number of long-tail tests       (default tests/20)
+#   MOCK_FAIL   number of failing tests         (default 0)
+#   MOCK_HANG   number of hanging tests         (default 0)
+#   MOCK_PERS   number of persistence pairs     (default 0)
+#   MOCK_TIMEOUT  TIMEOUT of every test         (default 10)
+
+set -e
+
+DEST=${1:?usage: mock_pintos.sh <dest> [tests] [seed]}
+N=${2:-100}
+SEED=${3:-1}
+MEAN=${MOCK_MEAN:-0.5}
+LONG=${MOCK_LONG:-$((N / 20))}
+FAIL=${MOCK_FAIL:-0}
+HANG=${MOCK_HANG:-0}
+PERS=${MOCK_PERS:-0}
+TIMEOUT=${MOCK_TIMEOUT:-10}
+
+rm -rf "$DEST"
+mkdir -p "$DEST/utils" "$DEST/tests/mock/specs" "$DEST/threads/build/tests/mock"
+DEST=$(cd "$DEST" && pwd)
+
+# -- utils/pintos: reads the spec put by -p, as pintos puts the test program --
+cat > "$DEST/utils/pintos" <<'EOF'
+#!/bin/sh
+timeout=60
+name=
+spec=
+while [ $# -gt 0 ]; do
+  case "$1" in
+    -T) shift; timeout=$1 ;;
+    -p) shift; spec=${1%%:*} ;;
+    run) shift; name=$1 ;;
+  esac
+  shift
+done
+[ -f "$spec" ] || { echo "no such test: $name" >&2; exit 1; }
+read -r dur verdict ticks faults writes < "$spec"
+echo "Boot complete."
+echo "Executing '$name':"
+if [ "$verdict" = hang ]; then
+  sleep "$timeout"
+  echo "TIMEOUT after $timeout seconds of host CPU time"
+  exit 0
+fi
+sleep "$dur"
+echo "($name) $verdict"
+echo "Execution of '$name' complete."
+echo "Timer: $ticks ticks"
+echo "Thread: 0 idle ticks, $ticks kernel ticks, 0 user ticks"
+echo "hd0:0: 0 reads, 0 writes"
+echo "hd0:1: $((ticks / 5)) reads, $writes writes"
+echo "Console: 1024 characters output"
+echo "Keyboard: 0 keys pressed"
+echo "Exception: $faults page faults"
+echo "Powering off..."
+EOF
+chmod +x "$DEST/utils/pintos"
+
+# -- test specs ---------------------------------------------------------------
+awk -v n="$N" -v seed="$SEED" -v mean="$MEAN" -v long="$LONG" \
+    -v fail="$FAIL" -v hang="$HANG" -v pers="$PERS" -v dir="$DEST/tests/mock/specs" '
+BEGIN {
+  srand(seed);
+  for (i = 0; i < n; ++i) {
+    name = sprintf("mock-%04d", i);
+    d = -log(1 - rand()) * mean;
+    if (i < long) d = d * 20 + mean * 10;
+    v = "pass";
+    if (i >= n - fail) v = "fail";
+    if (i >= n - fail - hang && i < n - fail) v = "hang";
+    printf "%.2f %s %d %d %d\n", d, v, int(d * 100) + 1, int(rand() * 50), int(rand() * 20) > (dir "/" name);
+    names = names " " name;
+  }
+  for (i = 0; i < pers; ++i) {
+    name = sprintf("pers-%02d", i);
+    printf "%.2f pass 10 0 5\n", mean > (dir "/" name);
+    printf "%.2f pass 10 0 0\n", mean / 2 > (dir "/" name "-persistence");
+    pnames = pnames " " name;
+  }
+  print names > (dir "/../TESTS");
+  print pnames > (dir "/../PERSISTENCE");
+}'
+
+# -- .ck: a shell script checking the verdict line --------------------------
+cat > "$DEST/tests/mock/check.sh" <<'EOF'
+#!/bin/sh
+# usage: check.sh <test> <result>
+name=$(basename "$1")
+if grep -q "($name) pass" "$1.output"; then
+  echo PASS > "$2"
+else
+  { echo FAIL; echo "Run didn't produce the expected verdict:"; cat "$1.output"; } > "$2"
+fi
+EOF
+chmod +x "$DEST/tests/mock/check.sh"
+for t in $(cat "$DEST/tests/mock/TESTS") $(cat "$DEST/tests/mock/PERSISTENCE"); do
+  echo "# mock check" > "$DEST/tests/mock/$t.ck"
+done
+for t in $(cat "$DEST/tests/mock/PERSISTENCE"); do
+  echo "# mock check" > "$DEST/tests/mock/$t-persistence.ck"
+done
+
+# -- Makefiles ------------------------------------------------------------------
+echo "# mock Make.config" > "$DEST/Make.config"
+
+cat > "$DEST/tests/Make.tests" <<EOF
+# -*- makefile -*-
+TEST_SUBDIRS = tests/mock
+PERSISTENCE_TESTS := \$(addprefix tests/mock/,\$(shell cat \$(SRCDIR)/tests/mock/PERSISTENCE))
+tests/mock_TESTS := \$(addprefix tests/mock/,\$(shell cat \$(SRCDIR)/tests/mock/TESTS)) \$(PERSISTENCE_TESTS)
+tests/mock_GRADES := \$(PERSISTENCE_TESTS:%=%-persistence)
+TESTS = \$(foreach subdir,\$(TEST_SUBDIRS),\$(\$(subdir)_TESTS))
+TIMEOUT = $TIMEOUT
+.PRECIOUS: %.output
+
+%.output: os.dsk
+	pintos -v -k -T \$(TIMEOUT) -p \$*:\$(notdir \$*) -- -q run \$(notdir \$*) < /dev/null 2> \$*.errors > \$*.output
+
+\$(PERSISTENCE_TESTS:%=%.output): %.output: os.dsk
+	rm -f \$*.tar
+	pintos -v -k -T \$(TIMEOUT) -p \$*:\$(notdir \$*) -- -q run \$(notdir \$*) < /dev/null 2> \$*.errors > \$*.output
+	touch \$*.tar
+
+%-persistence.output: %.output
+	pintos -v -k -T \$(TIMEOUT) -p \$*-persistence:\$(notdir \$*)-persistence -- -q run \$(notdir \$*)-persistence < /dev/null 2> \$*-persistence.errors > \$*-persistence.output
+
+%-persistence.result: %-persistence.ck %-persistence.output %.result
+	\$(SRCDIR)/tests/mock/check.sh \$*-persistence \$@
+
+%.result: %.ck %.output
+	\$(SRCDIR)/tests/mock/check.sh \$* \$@
+
+check: \$(TESTS:%=%.result) \$(PERSISTENCE_TESTS:%=%-persistence.result)
+	@cat \$^ | grep -c PASS | sed 's/^/PASS count: /'
+EOF
+
+cat > "$DEST/tests/mock/Grading" <<'EOF'
+# Percentage of the testing point total designated for each set of tests.
+100%	tests/mock/Rubric
+EOF
+{
+  echo "Functionality of the mock kernel:"
+  echo "- Mock tests."
+  for t in $(cat "$DEST/tests/mock/TESTS"); do echo "	1	$t"; done
+  echo "- Mock persistence."
+  for t in $(cat "$DEST/tests/mock/PERSISTENCE"); do echo "	2	$t"; done
+} > "$DEST/tests/mock/Rubric"
+
+cat > "$DEST/threads/Make.vars" <<'EOF'
+# -*- makefile -*-
+KERNEL_SUBDIRS = threads
+GRADING_FILE = $(SRCDIR)/tests/mock/Grading
+EOF
+
+cat > "$DEST/threads/Makefile" <<'EOF'
+# the specs stand for the test programs built from tests/
+all: build/Makefile build/kernel.bin build/os.dsk
+	@mkdir -p build/tests/mock
+	@cp ../tests/mock/specs/* build/tests/mock/
+
+# as pintos does, the build directory is generated
+build/Makefile: Makefile.build
+	mkdir -p build
+	cp Makefile.build build/Makefile
+
+build/kernel.bin build/os.dsk:
+	mkdir -p build
+	touch build/kernel.bin build/os.dsk
+
+check: all
+	$(MAKE) -C build check
+
+clean:
+	rm -rf build/tests build/kernel.bin build/os.dsk build/*.pincheck
+EOF
+
+cat > "$DEST/threads/Makefile.build" <<'EOF'
+SRCDIR = ../..
+VPATH = $(SRCDIR)
+include ../../Make.config
+include ../Make.vars
+include ../../tests/Make.tests
+EOF
+
+cp "$DEST/threads/Makefile.build" "$DEST/threads/build/Makefile"
+touch "$DEST/threads/build/kernel.bin" "$DEST/threads/build/os.dsk"
+cp "$DEST/tests/mock/specs/"* "$DEST/threads/build/tests/mock/"
+echo "mock pintos tree with $N tests at $DEST"
@@ -0,0 +1,89 @@
+#!/bin/sh
+# Benchmark discovery, scheduling and result handling of pincheck on mock
+# pintos trees (see mock_pintos.sh), without qemu.
+#
+# usage: bench/run_bench.sh <pincheck> [out dir]
+#
+# Tunables (environment), besides those of mock_pintos.sh:
+#   BENCH_SIZES  numbers of tests to try      (default "200 1000")
+#   BENCH_JOBS   -j of every run               (default 8)
+#   BENCH_SEED   seed of the mock trees        (default 1)
+#
+# For every size, pincheck runs twice: cold (without cache.pincheck) and
+# warm. The warm run is the one reported, except for discovery.
+
+set -e
+
+PINCHECK=$(cd "$(dirname "${1:?usage: run_bench.sh <pincheck> [out dir]}")" && pwd)/$(basename "$1")
+OUT=${2:-bench_out}
+SIZES=${BENCH_SIZES:-"200 1000"}
+JOBS=${BENCH_JOBS:-8}
+SEED=${BENCH_SEED:-1}
+HERE=$(cd "$(dirname "$0")" && pwd)
+
+# short tests, so that pincheck itself dominates
+export MOCK_MEAN=${MOCK_MEAN:-0.05}
+export MOCK_TIMEOUT=${MOCK_TIMEOUT:-10}
+
+mkdir -p "$OUT"
+OUT=$(cd "$OUT" && pwd)
+
+# prints the value of a "<label> <value>" line of the self profile
+profile_wall() {
+  awk -v phase="$1" '$1 == phase && NF == 5 { print $3 }' "$2"
+}
+
+run() {
+  (cd "$TREE/threads" && PATH="$TREE/utils:$PATH" "$PINCHECK" -nv -j "$JOBS" \
+    --self-profile --report-json "$1.jsonl" > "$1.log" 2>&1) || true
+}
+
+printf '%6s %5s %10s %10s %9s %8s %7s %12s %12s %9s\n' \
+  tests jobs "disc.cold" "disc.warm" makespan ideal above "dispatch.ms" "overhead.ms" "pincheck.cpu"
+for n in $SIZES; do
+  TREE="$OUT/mock-$n"
+  MOCK_FAIL=${MOCK_FAIL:-$((n / 50))} MOCK_PERS=${MOCK_PERS:-2} \
+    sh "$HERE/mock_pintos.sh" "$TREE" "$n" "$SEED" > /dev/null
+
+  run "$OUT/cold-$n"
+  run "$OUT/warm-$n"
+
+  cold=$(profile_wall discovery "$OUT/cold-$n.log")
+  warm=$(profile_wall discovery "$OUT/warm-$n.log")
+  makespan=$(awk '/^Makespan:/ { sub(/s,$/, "", $2); print $2 }' "$OUT/warm-$n.log")
+  dispatch=$(awk '/^Dispatch latency:/ { print $3 }' "$OUT/warm-$n.log")
+  cpu=$(awk '/^Total .* sec wall;/ { print $7 }' "$OUT/warm-$n.log")
+
+  # ideal makespan of the specs: the longest test or the work per slot;
+  # overhead is the duration of a test beyond the sleep of its kernel
+  stats=$(cat "$TREE"/tests/mock/specs/* | awk -v jobs="$JOBS" -v report="$OUT/warm-$n.jsonl" -v specs="$TREE/tests/mock/specs" '
+    {
+      sum += $1; if ($1 > max) max = $1
+    }
+    END {
+      ideal = sum / jobs > max ? sum / jobs : max
+      while ((getline line < report) > 0) {
+        name = line; sub(/.*"name":"/, "", name); sub(/".*/, "", name)
+        dur = line; sub(/.*"duration":/, "", dur); sub(/,.*/, "", dur)
+        spec = specs "/" name
+        getline s < spec; close(spec)
+        split(s, f, " ")
+        kernel = f[1]
+        if (line ~ /"subtitle":"Mock persistence\."/) {
+          spec = spec "-persistence"
+          getline s < spec; close(spec)
+          split(s, f, " ")
+          kernel += f[1]
+        }
+        over += dur - kernel; ++count
+      }
+      printf "%.1f %.1f", ideal, count ? 1000 * over / count : 0
+    }')
+  ideal=${stats% *}
+  overhead=${stats#* }
+  above=$(awk -v m="$makespan" -v i="$ideal" 'BEGIN { printf "%.1f%%", (i > 0 ? 100 * (m - i) / i : 0) }')
+
+  printf '%6s %5s %10s %10s %9s %8s %7s %12s %12s %9s\n' \
+    "$n" "$JOBS" "$cold" "$warm" "$makespan" "$ideal" "$above" "$dispatch" "$overhead" "$cpu"
+done
+echo "Logs and reports are kept in $OUT"
@@ -0,0 +1,24 @@
+#ifndef PINCHECK_AB_RUNNER_H
+#define PINCHECK_AB_RUNNER_H
+
+#include "common.h"
+#include "test_path.h"
+#include "test_case.h"
+
+struct AbOption {
+  bool is_verbose;
+  unsigned pool_size;
+  unsigned rounds;
+
+  AbOption();
+};
+
+// Runs every test on build A and build B in one pool, interleaved as
+// A B in odd rounds and B A in even rounds, so that both see the same
+// host load. Reports the paired differences (B - A) of wall time and
+// kernel counters of each test with 95% confidence intervals.
+int ab_run(const TestPath &a, const TestPath &b,
+  const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests,
+  const AbOption &opt);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef PINCHECK_BASELINE_H
+#define PINCHECK_BASELINE_H
+
+#include <map>
+#include <unordered_map>
+#include <ostream>
+#include "common.h"
+#include "test_result.h"
+
+enum class BaselineMode {
+  none, save, compare
+};
+
+Optional<BaselineMode> parse_baseline_mode(const String &s);
+
+// the metric of the wall time, besides the kernel counters
+constexpr char DURATION_METRIC[] = "duration";
+
+// Running mean and variance of samples (Welford).
+struct SampleStats {
+  unsigned n;
+  double mean, m2;
+
+  SampleStats();
+  void add(double x);
+  double stddev() const;
+};
+
+struct BaselineRegression {
+  String test, metric;
+  SampleStats before, after;
+};
+
+// Wall time and kernel counters of passing tests, one SampleStats per
+// test and metric; a sample per epoch. Saved as baseline.pincheck lines
+// of "<test> <metric> <n> <mean> <stddev>".
+class Baseline {
+private:
+  std::unordered_map<String, std::map<String, SampleStats>> tests;
+
+public:
+  Baseline();
+
+  // panics if the file cannot be read
+  static Baseline load(const Path &file);
+  void save(const Path &file) const;
+
+  void add(const TestResult &result);
+  size_t size() const;
+  // number of tests in both
+  size_t overlap(const Baseline &current) const;
+
+  // metrics of current beyond the threshold of this baseline
+  Vector<BaselineRegression> compare(const Baseline &current) const;
+};
+
+void print_regressions(std::ostream &os, const Vector<BaselineRegression> &regressions, size_t compared);
+
+#endif
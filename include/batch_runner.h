@@ -0,0 +1,35 @@
+#ifndef PINCHECK_BATCH_RUNNER_H
+#define PINCHECK_BATCH_RUNNER_H
+
+#include "common.h"
+#include "test_path.h"
+#include "test_discovery.h"
+#include "run_metrics.h"
+
+// one pintos tree and project to check
+struct BatchUnit {
+  String label;
+  TestPath paths; // src and project
+};
+
+struct BatchOption {
+  bool is_verbose;
+  unsigned pool_size;
+  unsigned builds; // units built at once
+  TestFilter filter;
+  Optional<Path> report_json;
+  String unit_name; // what a unit is called in the report
+  RunMetrics *metrics; // may be nullptr
+
+  BatchOption();
+};
+
+// Builds the units concurrently, at most opt.builds at a time, and feeds
+// the tests of each unit into one shared pool as soon as it is built and
+// discovered. A free slot goes to the unit with the fewest running tests,
+// the earlier one on a tie, so builds overlap with tests and the tail of
+// one unit is filled by the next. Reports the passes and the rubric score
+// of each unit; fails if any unit does not build or any test fails.
+int batch_run(const Vector<BatchUnit> &units, const BatchOption &opt);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef PINCHECK_BISECT_RUNNER_H
+#define PINCHECK_BISECT_RUNNER_H
+
+#include "common.h"
+#include "test_path.h"
+#include "test_case.h"
+
+struct BisectOption {
+  unsigned slots;   // revisions built and tested at once
+  unsigned repeats; // runs of the tests on each revision, for flaky tests
+
+  BisectOption();
+};
+
+// Finds the first revision in good..bad (as "<good>..<bad>") on which any
+// of the tests fails. Each round builds up to opt.slots revisions evenly
+// spaced in the remaining range, each in its own git worktree, and runs
+// the tests on them concurrently; a revision that does not build is
+// skipped. good and bad are tested first with the same repeats. Returns
+// nonzero if good fails, bad passes, or skipped revisions leave the first
+// bad one undecided.
+int bisect_run(const TestPath &paths, const String &range,
+  const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests,
+  const BisectOption &opt);
+
+#endif
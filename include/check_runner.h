@@ -1,11 +1,52 @@
 #ifndef PINCHECK_CHECK_RUNNER_H
 #define PINCHECK_CHECK_RUNNER_H
 
+#include <chrono>
 #include "common.h"
 #include "test_path.h"
 #include "test_case.h"
+#include "trace_log.h"
+#include "self_profile.h"
+#include "test_history.h"
+#include "kernel_stats.h"
+#include "baseline.h"
+#include "remote_worker.h"
+#include "run_metrics.h"
+
+// how often check_run polls the pool and redraws
+constexpr auto CHECK_POLL_INTERVAL = std::chrono::milliseconds(200);
+
+struct CheckOption {
+  bool is_verbose;
+  unsigned pool_size;
+  unsigned repeats; // 0 for no limit in soak mode
+
+  // soak mode; aggregates results instead of keeping them
+  bool until_fail;
+  Optional<std::chrono::seconds> soak;
+  Path soak_dir;
+
+  // machine-readable reports
+  Optional<Path> report_json, junit;
+  TraceLog *trace; // may be nullptr
+
+  // performance baseline
+  BaselineMode baseline;
+  Path baseline_file;
+  bool baseline_fail;
+
+  // owned by the caller, which loads and reports them; each may be nullptr
+  TestHistory *history;
+  KernelStatsStore *kernel_stats;
+  SelfProfile *profile;
+  RemotePool *remote; // its slots come after pool_size local ones, at least one
+  RunMetrics *metrics;
+
+  CheckOption();
+  bool is_soak() const;
+};
 
 int check_run(const TestPath &paths, const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests,
-  bool is_verbose, unsigned pool_size, unsigned repeats);
+  const CheckOption &opt);
 
 #endif
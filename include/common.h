@@ -4,6 +4,7 @@
 #include <deque>
 #include <algorithm>
 #include <optional>
+#include <utility>
 
 #if __GNUC__ > 7
 #include <filesystem>
@@ -4,6 +4,6 @@
 #include <sys/ioctl.h>
 #include "common.h"
 
-struct winsize get_winsize();
+struct winsize get_winsize(int fd = 0);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef PINCHECK_CONTROL_SOCKET_H
+#define PINCHECK_CONTROL_SOCKET_H
+
+#include <chrono>
+#include "common.h"
+
+// Steers a running check session through pincheck-control.sock in the
+// build directory; check_run answers between dispatches. One command per
+// line, answered by lines of text and then OK or ERR <message>:
+//   list             running tests with their slot and elapsed seconds,
+//                    then queued ones in the order they will run
+//   cancel <test>    kill a running test; it is reported as failed
+//   bump <test>      run a queued test before the others
+//   slots <n>        use n of the -j local slots from now on
+//   summary          the results so far
+//   stop             dispatch no more tests; the run ends with the summary
+//                    once the running ones finish
+// A test is its full name, or its name if no other test has it.
+
+struct ControlRequest {
+  int fd;
+  String line;
+};
+
+class ControlSocket {
+private:
+  struct Client {
+    int fd;
+    String buffer;
+  };
+
+  int listen_fd;
+  Path file;
+  Vector<Client> clients;
+
+  ControlSocket(const ControlSocket&) = delete;
+  ControlSocket& operator=(const ControlSocket&) = delete;
+
+public:
+  // not open if another session of the build has it
+  explicit ControlSocket(Path file);
+  ~ControlSocket() noexcept;
+
+  bool is_open() const;
+  // Waits up to timeout, returning at once when commands come in.
+  Vector<ControlRequest> wait(std::chrono::milliseconds timeout);
+  // the lines of the answer, then OK, or ERR with the message if given
+  void reply(const ControlRequest &req, const String &text, const Optional<String> &error = std::nullopt);
+};
+
+Path control_socket(const Path &build);
+
+// Sends a command to the session of the project around cwd and prints the
+// answer; 0 on OK.
+int control_client(const Path &cwd, const String &project, const String &command);
+
+#endif
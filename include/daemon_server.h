@@ -0,0 +1,49 @@
+#ifndef PINCHECK_DAEMON_SERVER_H
+#define PINCHECK_DAEMON_SERVER_H
+
+#include "common.h"
+#include "test_path.h"
+#include "test_discovery.h"
+#include "test_history.h"
+#include "kernel_stats.h"
+
+// Keeps one built project warm between invocations. The daemon listens on
+// pincheck.sock in the build directory; a client passes its stdin, stdout
+// and stderr with the request, so a forked child of the daemon runs the
+// request straight onto the terminal of the client.
+//
+// Over the Unix socket; > from the client:
+//   > RUN <identity> <project|-> <args>\n<cwd>\n<arg>\n...   (with fds 0, 1, 2)
+//   < OK | NO <reason>
+//   > INT                              (the client was interrupted)
+//   < EXIT <code>
+
+// what a daemon keeps between requests
+struct DaemonState {
+  TestPath paths;
+  DiscoveredTests catalog; // every test of the project
+  Optional<TestHistory> history;
+  Optional<KernelStatsStore> kernel_stats;
+
+  String fingerprint; // of the sources the catalog was built from
+  fs::file_time_type history_time, kernel_stats_time;
+};
+
+// runs one request in a child of the daemon, with its cwd and argv
+using DaemonRun = int (*)(DaemonState &state, const Vector<String> &args, const Path &cwd);
+
+Path daemon_socket(const Path &build);
+// the socket of a daemon for the project around cwd, if any
+Optional<Path> find_daemon_socket(const Path &cwd, const String &project);
+
+// Discovers every test of the built project and serves requests one at a
+// time until killed, rebuilding and discovering again first whenever the
+// sources changed since the last build.
+int daemon_serve(const TestPath &paths, const String &version, DaemonRun run);
+
+// The exit code of the request served by the daemon; nullopt if no daemon
+// takes it, and it has to run here. An empty project is any project.
+Optional<int> daemon_client(const Path &socket, const String &version, const String &project,
+  const Vector<String> &args, const Path &cwd);
+
+#endif
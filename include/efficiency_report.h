@@ -0,0 +1,45 @@
+#ifndef PINCHECK_EFFICIENCY_REPORT_H
+#define PINCHECK_EFFICIENCY_REPORT_H
+
+#include <chrono>
+#include <ostream>
+#include "common.h"
+#include "test_result.h"
+
+// How well one epoch of check_run used its pool slots.
+class EfficiencyReport {
+private:
+  using TimePoint = std::chrono::system_clock::time_point;
+
+  struct SlotStat {
+    double busy_sec;
+    size_t tests;
+    Optional<TimePoint> last_end;
+  };
+
+  Vector<SlotStat> slots;
+  TimePoint start_time, end_time;
+
+  double busy_sec, persistence_sec;
+  double gap_sec;
+  size_t gaps;
+
+  String longest_name;
+  double longest_sec;
+  TimePoint longest_start;
+
+public:
+  explicit EfficiencyReport(size_t pool_size);
+
+  // a runner of the slot finished; first result of the runner only
+  void record(size_t slot, const TestResult &result);
+  void finish();
+
+  double makespan_sec() const;
+  double lower_bound_sec() const;
+  double utilization() const;
+
+  void print(std::ostream &os) const;
+};
+
+#endif
@@ -2,13 +2,68 @@
 #define PINCHECK_EXECUTION_H
 
 #include <sstream>
+#include <mutex>
+#include <stdexcept>
+#include <sys/types.h>
 #include "common.h"
 
+// resource usage of a finished process tree, from wait4(2)
+struct ResourceUsage {
+  double user_sec, sys_sec;
+  long max_rss_kb;
+  long nvcsw, nivcsw;   // voluntary / involuntary context switches
+  long inblock, oublock;
+
+  ResourceUsage();
+  ResourceUsage& operator+=(const ResourceUsage &rhs);
+};
+
+// the shell of a running exec_str, for another thread to kill
+class SpawnedProcess {
+private:
+  std::mutex mut;
+  pid_t pid; // 0 if none; not reaped while set
+
+public:
+  SpawnedProcess();
+  void set(pid_t pid);
+  // the shell and every process it spawned, as found in /proc
+  void kill_tree(int sig);
+};
+
 Pair<int, Optional<String>> exec_str(const char *cmd) noexcept;
+Pair<int, Optional<String>> exec_str(const char *cmd, ResourceUsage &usage, SpawnedProcess *spawned = nullptr) noexcept;
 int exec_ret(const char *cmd) noexcept;
+// number of shells spawned by exec_str and exec_ret so far, by all threads
+// or by the calling thread only
+unsigned long spawned_processes() noexcept;
+unsigned long spawned_processes_here() noexcept;
 
 extern const unsigned HARDWARE_CONCURRENCY;
 
+// What panic throws instead of exiting while a PanicScope lives on the
+// calling thread: for work done beside others, as a build of one revision
+// or one test, whose failure is to be reported rather than end pincheck.
+class PanicError : public std::runtime_error {
+public:
+  explicit PanicError(const String &msg);
+};
+
+class PanicScope {
+private:
+  PanicScope(const PanicScope&) = delete;
+  PanicScope& operator=(const PanicScope&) = delete;
+
+public:
+  PanicScope() noexcept;
+  ~PanicScope() noexcept;
+};
+
+// Called by panic instead of printing and exiting, if set; it must not
+// return. libpincheck throws from it, so an embedding process survives.
+using PanicHandler = void(*)(const String &msg, int exit_code);
+void set_panic_handler(PanicHandler handler) noexcept;
+
 [[noreturn]] void panic(const String& msg, int exit_code=1);
 [[noreturn]] void panic(const std::ostringstream& os, int exit_code=1);
 
@@ -0,0 +1,18 @@
+#ifndef PINCHECK_GIT_WORKTREE_H
+#define PINCHECK_GIT_WORKTREE_H
+
+#include "common.h"
+
+// Checks out rev of the git repository containing src into dir, as a
+// detached worktree which is reused if it exists, and returns the path of
+// src inside it. Panics if git fails.
+Path checkout_worktree(const Path &src, const String &rev, const Path &dir);
+
+// full commit hash of rev in the repository containing src
+String resolve_rev(const Path &src, const String &rev);
+// commits on the ancestry path from good (exclusive) to bad (inclusive), oldest first
+Vector<String> rev_list(const Path &src, const String &good, const String &bad);
+// abbreviated hash and subject of a commit
+String describe_commit(const Path &src, const String &commit);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef PINCHECK_KERNEL_STATS_H
+#define PINCHECK_KERNEL_STATS_H
+
+#include <unordered_map>
+#include "common.h"
+
+// Statistics pintos prints at power-off, as named counters in the order
+// printed; e.g. "Exception: 3 page faults" is page_faults = 3 and
+// "hd0:1: 61 reads, 2 writes" is hd0:1_reads = 61, hd0:1_writes = 2.
+struct KernelStats {
+  Vector<Pair<String, long>> counters;
+
+  bool empty() const;
+  Optional<long> get(const String &name) const;
+  void set(const String &name, long value);
+};
+
+KernelStats parse_kernel_stats(const String &output);
+// parses the tail of an .output file, where the statistics are
+KernelStats read_kernel_stats(const String &output_file);
+
+// counters that grow when a kernel gets less efficient; ticks depend on
+// the load of the host and are not
+bool is_efficiency_counter(const String &name);
+
+struct KernelGrowth {
+  String counter;
+  long before, after;
+};
+
+// efficiency counters that grew noticeably from before to after
+Vector<KernelGrowth> kernel_growth(const KernelStats &before, const KernelStats &after);
+
+// Statistics of the last run of every test, kept in kernel_stats.pincheck
+// of the build directory.
+class KernelStatsStore {
+private:
+  std::unordered_map<String, KernelStats> entries;
+  Path file;
+
+public:
+  explicit KernelStatsStore(Path file);
+
+  const KernelStats *find(const String &full_name) const;
+  void record(const String &full_name, const KernelStats &stats);
+  void save() const;
+};
+
+#endif
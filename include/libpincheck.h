@@ -0,0 +1,131 @@
+#ifndef PINCHECK_LIBPINCHECK_H
+#define PINCHECK_LIBPINCHECK_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <stdexcept>
+
+// The embeddable API of libpincheck.a: builds a pintos project, lists its
+// tests and runs them in slots as pincheck does, delivering results through
+// callbacks instead of printing them. This header is the stable part and
+// needs nothing else from include/; the rest of the library may change.
+//
+//   c++ -std=c++17 -I pincheck/include grader.cpp pincheck/build/libpincheck.a -lpthread
+//
+// (and -lstdc++fs before GCC 9). Tests run make and pintos through the
+// shell, so PATH must have the pintos utils. Runs of different projects do
+// not share state; one thread can poll several, or each can have a thread.
+namespace pincheck {
+
+constexpr int API_VERSION = 1;
+
+// what ends the pincheck binary with a panic, such as a build directory
+// that cannot list its tests
+class Error : public std::runtime_error {
+public:
+  explicit Error(const std::string &msg);
+};
+
+struct Test {
+  std::string subdir, name; // tests/threads, alarm-single
+  int timeout;              // TIMEOUT in seconds
+  bool persistence;         // a filesys test checked again after a reboot
+
+  std::string full_name() const;
+};
+
+struct Result {
+  Test test;
+  bool passed;
+  std::string status; // "pass", "fail" or "error"
+  std::string reason; // of a failure, from the output; empty if passed
+  std::string output; // of a failure, or of any test with keep_output
+  double sec;                // wall time
+  double run_sec, check_sec; // pintos, and the .ck check
+};
+
+// wildcard patterns, as -t, -sd, -e and --subdir-exclude; empty tests or
+// subdirs accept all
+struct Filter {
+  std::vector<std::string> tests, subdirs, exclude_tests, exclude_subdirs;
+};
+
+class Project {
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl;
+
+  friend class Run;
+
+public:
+  // src is the pintos src directory; project is one of its directories,
+  // as threads. The build is src/project/build, made or not yet.
+  Project(const std::string &src, const std::string &project);
+  ~Project();
+  Project(Project&&) noexcept;
+  Project& operator=(Project&&) noexcept;
+
+  // make with the given jobs; false with the output of make in error
+  bool build(unsigned jobs, std::string &error);
+  // the tests of the build the filter accepts, persistence ones last;
+  // discovered once, again after each build
+  std::vector<Test> tests(const Filter &filter = Filter{});
+  std::string build_dir() const;
+};
+
+struct RunOptions {
+  unsigned slots = 1;
+  bool keep_output = false;
+  // longest first by history.pincheck of the build, recording into it
+  bool history = true;
+};
+
+using StartCallback = void(*)(const Test &test, void *user);
+using ResultCallback = void(*)(const Result &result, void *user);
+
+struct Callbacks {
+  StartCallback on_start = nullptr;
+  ResultCallback on_result = nullptr;
+  void *user = nullptr;
+};
+
+// passed and failed count results, two for a persistence test; not_run
+// counts tests
+struct Summary {
+  unsigned passed = 0, failed = 0, not_run = 0;
+  double sec = 0;
+};
+
+// One run of tests of a project, which must outlive it. Nothing starts
+// until it is polled; callbacks are called on the polling thread.
+class Run {
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl;
+
+  void step();
+
+public:
+  // the tests are of project.tests(); throws Error for others
+  Run(Project &project, const std::vector<Test> &tests, const RunOptions &options, const Callbacks &callbacks = Callbacks{});
+  // cancels what is left
+  ~Run();
+  Run(Run&&) noexcept;
+  Run& operator=(Run&&) noexcept;
+
+  // Collects finished tests and fills free slots, waiting up to timeout
+  // in between; false once every test finished.
+  bool poll(std::chrono::milliseconds timeout);
+  // dispatches no more tests and kills the running ones, which come back
+  // as failed; the rest count as not run
+  void cancel();
+  // polls until every test finished
+  Summary wait();
+  Summary summary() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef PINCHECK_REMOTE_WORKER_H
+#define PINCHECK_REMOTE_WORKER_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include "common.h"
+#include "execution.h"
+#include "test_case.h"
+#include "test_path.h"
+
+// Runs the run phase of tests on other hosts. The coordinator sends the
+// command make would run for the .output, with the files it reads (os.dsk,
+// kernel.bin and those put by -p) by content hash; a worker keeps them in
+// its cache, runs the command in a scratch directory and sends back the
+// files it redirects to. The check phase stays on the coordinator.
+//
+// A worker listens on 127.0.0.1 unless given a host, and runs nothing but
+// pintos: a command with other shell in it is refused. Both ends share a
+// token, which every connection sends first; a peer without it is dropped.
+// Over TCP, one job at a time per connection; > from the coordinator:
+//   > HELLO <version> <token>         < HELLO <slots> | ERR <message>
+//   > HAVE <hash>                     < YES | NO
+//   > PUT <hash> <size>\n<bytes>      < OK | ERR <message>
+//   > RUN <inputs> <outputs> <size>\n<hash> <path>\n...<path>\n...<command>
+//   < DONE <exit> <user> <sys> <max_rss_kb> <files>\n(<path> <size>\n<bytes>)...
+//   < ERR <message>
+
+// a socket with buffered reads
+class Connection {
+private:
+  int fd;
+  String buffer;
+
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+
+public:
+  explicit Connection(int fd);
+  ~Connection() noexcept;
+
+  static std::unique_ptr<Connection> connect(const String &address);
+
+  bool send(const String &bytes);
+  Optional<String> read_line();
+  Optional<String> read_bytes(size_t size);
+};
+
+// SHA-256 of the bytes in hex, and their size
+String content_hash(const String &bytes);
+// A pintos invocation as make writes it for a .output: plain words, single
+// quoted arguments, < /dev/null, and > or 2> into a relative path. A
+// worker runs nothing else.
+bool is_launcher_command(const String &command);
+
+// "host:port", ":port" or "port"; the default port if none
+Pair<String, String> split_address(const String &address);
+
+// Serves coordinators with the token until killed, running at most slots
+// jobs at once.
+int worker_serve(const String &address, unsigned slots, const Path &cache_dir, const String &token);
+
+// content hashes of local files, kept while their size and mtime hold
+struct HashCache {
+  std::mutex mut;
+  std::unordered_map<String, Pair<Pair<uintmax_t, long long>, String>> entries;
+
+  Optional<String> hash(const Path &file);
+};
+
+struct RemoteHost {
+  String address;
+  unsigned slots;
+  std::mutex mut;
+  std::unordered_set<String> known; // hashes the worker has
+};
+
+// one connection to a worker, used by one TestRunner at a time
+class RemoteSlot {
+private:
+  friend class RemotePool;
+
+  RemoteHost &host;
+  std::unique_ptr<Connection> conn;
+  HashCache &hashes;
+  String lost; // why the worker was given up, if it was
+
+  // the hash the worker has the file by; nullopt if it cannot be sent,
+  // with broken set if the connection broke
+  Optional<String> upload(const Path &file, bool &broken);
+
+public:
+  RemoteSlot(RemoteHost &host, std::unique_ptr<Connection> conn, HashCache &hashes);
+
+  const String &lost_reason() const;
+  // given up after a broken connection; no test is to be put in it
+  bool is_lost() const;
+  // runs the .output of the test on the worker and writes the outputs in
+  // the build directory; nullopt if it is to be run here instead
+  Optional<int> run_output(const TestPath &paths, const TestCase &testcase, ResourceUsage &usage);
+};
+
+class RemotePool {
+private:
+  Vector<std::unique_ptr<RemoteHost>> hosts;
+  Vector<std::unique_ptr<RemoteSlot>> slots;
+  HashCache hashes;
+
+public:
+  // connects to every worker with the token, as many connections as its
+  // slots; panics if one cannot be reached or refuses the token
+  RemotePool(const Vector<String> &addresses, const String &token);
+
+  size_t size() const;
+  RemoteSlot *slot(size_t i);
+  // the workers, and those given up during the run
+  void print(std::ostream &os) const;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef PINCHECK_RESULT_REPORT_H
+#define PINCHECK_RESULT_REPORT_H
+
+#include <fstream>
+#include "common.h"
+#include "test_result.h"
+
+// One JSON object per line, written and flushed as each test finishes.
+class JsonReport {
+private:
+  std::ofstream fs;
+
+public:
+  explicit JsonReport(const Path &file);
+  void write(const TestResult &result, unsigned epoch);
+};
+
+// a top-level field of a JsonReport line; a string is unescaped, other
+// values are returned as written
+Optional<String> json_field(const String &line, const String &key);
+
+// JUnit XML for CI. Each epoch becomes one <testsuite>, written when
+// the epoch ends; only the compact entries of the current epoch are kept.
+// The file is a complete document after each epoch.
+class JunitReport {
+private:
+  struct Entry {
+    String classname, name;
+    double sec;
+    String status, reason;
+  };
+
+  std::ofstream fs;
+  Vector<Entry> entries;
+  std::chrono::system_clock::time_point suite_start;
+  std::streampos suites_end;
+
+  void close_document();
+
+public:
+  explicit JunitReport(const Path &file);
+
+  void add(const TestResult &result);
+  void end_epoch(const String &suite_name);
+};
+
+#endif
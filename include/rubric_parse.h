@@ -2,6 +2,7 @@
 #define PINCHECK_RUBRIC_PARSE_H
 
 #include <unordered_map>
+#include <unordered_set>
 #include "common.h"
 #include "test_case.h"
 
@@ -10,8 +11,13 @@ struct Rubric {
   String title;
   double max_pct;
   std::unordered_map<String, Vector<String>> subtitles;
+  std::unordered_map<String, unsigned> points;
 };
 
-Vector<Rubric> parse_rubric(const Path& grading_file, Vector<TestCase> &target_tests, Vector<TestCase> &persistence_tests);
+// rubric files in the grading file are relative to src
+Vector<Rubric> parse_rubric(const Path& grading_file, const Path &src, Vector<TestCase> &target_tests, Vector<TestCase> &persistence_tests);
+// share of rubric.max_pct earned, given the full names of passed tests; the
+// tests of a persistence rubric are scored by their -persistence halves
+double rubric_score(const Rubric &rubric, const std::unordered_set<String> &passed);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef PINCHECK_RUN_METRICS_H
+#define PINCHECK_RUN_METRICS_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include "common.h"
+#include "test_result.h"
+
+// Counters, gauges and histograms of check_run and batch_run for
+// monitoring, in the Prometheus text format. They are written to a file,
+// replaced at most once a second as for the textfile collector of
+// node_exporter, and/or served over HTTP on 127.0.0.1.
+class RunMetrics {
+private:
+  using TimePoint = std::chrono::system_clock::time_point;
+
+  struct Histogram {
+    Vector<double> bounds;
+    Vector<unsigned long> counts; // per bound, not cumulative; the last is +Inf
+    double sum;
+    unsigned long count;
+
+    explicit Histogram(Vector<double> bounds);
+    void observe(double value);
+  };
+
+  mutable std::mutex mut;
+  unsigned long started, passed, failed, timed_out;
+  Histogram duration, spawn_latency, dispatch_latency;
+  std::map<String, double> last_duration; // by full name
+  double busy_sec, discovery_sec;
+  size_t slots, busy, queued;
+  Vector<TimePoint> dispatch_time;
+  Vector<Optional<TimePoint>> last_end;
+  Optional<TimePoint> first_dispatch;
+
+  Optional<Path> file;
+  std::chrono::steady_clock::time_point last_write;
+  int listen_fd;
+  std::atomic<bool> stopping;
+  std::thread server;
+
+  RunMetrics(const RunMetrics&) = delete;
+  RunMetrics& operator=(const RunMetrics&) = delete;
+
+  void serve();
+  String render() const;
+
+public:
+  // panics if the port cannot be listened on
+  RunMetrics(Optional<Path> file, Optional<unsigned> port);
+  ~RunMetrics() noexcept;
+
+  void discovery(double sec);
+  // a runner put into the slot
+  void dispatched(size_t slot);
+  // a runner of the slot finished with the results
+  void finished(size_t slot, const Vector<TestResult> &results);
+  void pool(size_t slots, size_t busy, size_t queued);
+  // rewrites the file if a second passed since the last time, or if forced
+  void flush(bool force = false);
+};
+
+#endif
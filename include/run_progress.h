@@ -0,0 +1,48 @@
+#ifndef PINCHECK_RUN_PROGRESS_H
+#define PINCHECK_RUN_PROGRESS_H
+
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include "common.h"
+#include "test_case.h"
+#include "test_history.h"
+#include "test_runner.h"
+
+// Expected progress of one epoch of check_run. Each runner is weighted by
+// its recorded duration, snapshotted at the start of the epoch; without
+// any history every runner weighs the same and the ETA is extrapolated
+// from the elapsed time.
+class RunProgress {
+private:
+  struct Expectation {
+    double sec;
+    bool recorded;
+  };
+
+  std::unordered_map<String, Expectation> expected;
+  size_t pool_size;
+  bool has_history;
+  double total_sec, done_sec;
+  std::chrono::system_clock::time_point start_time;
+
+  const Expectation &expectation(const TestCase &testcase) const;
+  // expected work done by the running ones so far
+  double running_done_sec(const Vector<std::unique_ptr<TestRunner>> &pool) const;
+
+public:
+  RunProgress(const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests,
+    const TestHistory *history, size_t pool_size);
+
+  // recorded duration of the test, if any
+  Optional<double> expected_sec(const TestCase &testcase) const;
+  // running far beyond its recorded duration; may hang
+  bool overdue(const TestCase &testcase, double elapsed_sec) const;
+
+  void finish(const TestCase &testcase);
+
+  double fraction(const Vector<std::unique_ptr<TestRunner>> &pool) const;
+  Optional<std::chrono::seconds> eta(const Vector<std::unique_ptr<TestRunner>> &pool) const;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef PINCHECK_RUN_SIMULATOR_H
+#define PINCHECK_RUN_SIMULATOR_H
+
+#include "common.h"
+#include "test_case.h"
+#include "test_history.h"
+#include "test_scheduler.h"
+
+struct SimulationResult {
+  unsigned jobs;
+  TestOrder order;
+  double makespan_sec, busy_sec;
+  double utilization;
+};
+
+// Replays the tests through the dispatching rule of check_run (TestQueue
+// and its polling interval) in virtual time, using recorded durations.
+// Beyond the hardware concurrency, the recorded CPU share of each duration
+// is stretched by jobs/cores.
+SimulationResult simulate_run(Vector<TestCase> target_tests, const Vector<TestCase> &persistence_tests,
+  const TestHistory &history, unsigned jobs, TestOrder order);
+
+// Simulates 1..max_jobs jobs for every order, prints the table and
+// recommends a number of jobs.
+int simulate(const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests,
+  const TestHistory &history, unsigned max_jobs);
+
+#endif
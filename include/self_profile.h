@@ -0,0 +1,49 @@
+#ifndef PINCHECK_SELF_PROFILE_H
+#define PINCHECK_SELF_PROFILE_H
+
+#include <mutex>
+#include <chrono>
+#include <ostream>
+#include "common.h"
+
+// Wall and CPU time pincheck itself spends in each of its phases, with the
+// number of processes spawned. CPU time and spawns are of the calling
+// thread only, so the tests running in the pool do not count.
+class SelfProfile {
+private:
+  struct Phase {
+    String name;
+    unsigned depth;
+    unsigned long calls, spawned;
+    double wall_sec, cpu_sec;
+  };
+
+  Vector<Phase> phases; // in order of first entry
+  std::mutex mut;
+  std::chrono::steady_clock::time_point start;
+
+public:
+  SelfProfile();
+
+  // the index of the phase to pass to leave
+  size_t enter(const String &name, unsigned depth);
+  void leave(size_t index, double wall_sec, double cpu_sec, unsigned long spawned);
+  void print(std::ostream &os);
+};
+
+// Adds the span from its construction to its destruction to profile.
+// Scopes nest; does nothing if profile is nullptr.
+class ProfileScope {
+private:
+  SelfProfile *profile;
+  size_t index;
+  unsigned long spawned;
+  std::chrono::steady_clock::time_point start;
+  double cpu_start;
+
+public:
+  ProfileScope(SelfProfile *profile, String name);
+  ~ProfileScope();
+};
+
+#endif
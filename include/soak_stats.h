@@ -0,0 +1,41 @@
+#ifndef PINCHECK_SOAK_STATS_H
+#define PINCHECK_SOAK_STATS_H
+
+#include <map>
+#include <chrono>
+#include "common.h"
+#include "test_result.h"
+
+// log2-scaled duration buckets: <1s, <2s, <4s, ..., <256s, and the rest
+constexpr size_t SOAK_BUCKETS = 10;
+
+struct SoakCounter {
+  unsigned runs, passed, failed;
+  double total_sec, max_sec;
+  std::array<unsigned, SOAK_BUCKETS> histogram;
+
+  SoakCounter();
+};
+
+class SoakStats {
+private:
+  std::map<String, SoakCounter> counters;
+  unsigned epochs, epochs_passed;
+  size_t spilled;
+  Path spill_dir;
+  std::chrono::system_clock::time_point start_time;
+
+public:
+  explicit SoakStats(Path spill_dir);
+
+  Optional<Path> record(const TestResult &result, unsigned epoch);
+  void end_epoch(bool passed);
+
+  unsigned get_epochs() const;
+  unsigned get_epochs_passed() const;
+  std::chrono::seconds elapsed() const;
+
+  void print_summary(std::ostream &os, bool full) const;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef PINCHECK_SOCKET_HELPER_H
+#define PINCHECK_SOCKET_HELPER_H
+
+#include <sys/un.h>
+#include "common.h"
+
+// false if the path does not fit in sun_path
+bool fill_address(const Path &socket, sockaddr_un &addr);
+// a stream socket connected to the Unix socket, or -1
+int connect_socket(const Path &socket);
+// retries short and interrupted sends; false once the peer is gone
+bool send_all(int fd, const String &bytes);
+// a line from fd without its newline, keeping what follows it in buffer;
+// nullopt at the end, or past max_line bytes without a newline
+Optional<String> read_line(int fd, String &buffer, size_t max_line);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef PINCHECK_STATUS_RENDERER_H
+#define PINCHECK_STATUS_RENDERER_H
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <unordered_set>
+#include <signal.h>
+#include "common.h"
+#include "test_runner.h"
+#include "run_progress.h"
+
+// Draws finished rows and the "Running(..)" status line of check_run.
+// Each frame is composed into one buffer and written with a single
+// write(2). When stdout is not a terminal, no escape codes are emitted
+// and the status line is only appended as a periodic heartbeat.
+// With a RunProgress, the status line starts with a progress bar and an
+// ETA, and a test running far beyond its recorded duration is flagged.
+// The owner calls clear before printing anything else; the destructor
+// does not, so nothing is drawn after the owner's last print.
+class StatusRenderer {
+private:
+  bool is_tty;
+  std::chrono::milliseconds min_interval, heartbeat_interval;
+  std::chrono::system_clock::time_point last_frame, last_heartbeat;
+
+  std::ostringstream rows;
+  String frame, last_status;
+  unsigned short columns;
+  struct sigaction old_winch;
+
+  const RunProgress *progress;
+  std::unordered_set<String> overdue_tests;
+
+  StatusRenderer(const StatusRenderer&) = delete;
+  StatusRenderer& operator=(const StatusRenderer&) = delete;
+
+  String compose_progress(const Vector<std::unique_ptr<TestRunner>> &pool);
+  String compose_status(const Vector<std::unique_ptr<TestRunner>> &pool, bool colored);
+  void check_overdue(const Vector<std::unique_ptr<TestRunner>> &pool);
+  void write_frame();
+
+public:
+  explicit StatusRenderer(const RunProgress *progress = nullptr,
+    std::chrono::milliseconds min_interval = std::chrono::milliseconds(100));
+  ~StatusRenderer() noexcept;
+
+  // for the next epoch of check_run
+  void set_progress(const RunProgress *progress);
+  bool tty() const;
+
+  // finished rows go here; they are written with the next frame
+  std::ostream &row_stream();
+
+  void render(const Vector<std::unique_ptr<TestRunner>> &pool, bool force = false);
+  // writes pending rows and erases the status line, before other prints
+  void clear();
+};
+
+#endif
@@ -1,11 +1,20 @@
 #ifndef PINCHECK_STRING_HELPER_H
 #define PINCHECK_STRING_HELPER_H
 
+#include <chrono>
 #include "common.h"
 
 String string_trim(String s);
 Vector<String> string_tokenize(String line);
 bool wildcard_match(const String &target, const String &pattern);
 bool wildcard_match(const String &target, const Vector<String> &patterns);
+// nullopt for a zero duration, or one too long for a clock
+Optional<std::chrono::seconds> parse_duration(const String &s);
+String format_duration(std::chrono::seconds d);
+String format_fixed(double value, int precision);
+String json_escape(const String &s);
+String xml_escape(const String &s);
+// single-quoted for /bin/sh
+String shell_quote(const String &s);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef PINCHECK_TEST_DISCOVERY_H
+#define PINCHECK_TEST_DISCOVERY_H
+
+#include "common.h"
+#include "test_path.h"
+#include "test_case.h"
+#include "rubric_parse.h"
+#include "self_profile.h"
+
+// wildcard patterns of --test, --subdir and their excludes
+struct TestFilter {
+  Vector<String> names, subdirs;
+  Vector<String> exclude_names, exclude_subdirs;
+
+  TestFilter();
+  bool accepts(const String &subdir, const String &name) const;
+};
+
+struct DiscoveredTests {
+  Vector<TestCase> target_tests, persistence_tests;
+  Vector<Rubric> rubrics;
+};
+
+int parse_timeout(const String &command);
+// the command make runs for the test in the build directory; nullopt if
+// it is more than one, as for a persistence pair
+Optional<String> get_raw_running_command(const Path &build, const String &full_name);
+
+// Lists the tests of the project built in paths.build through
+// Make.pincheck, with their TIMEOUT and persistence kept in cache.pincheck,
+// and parses the rubrics of the grading file. Does not depend on the cwd.
+DiscoveredTests discover_tests(const TestPath &paths, const TestFilter &filter, SelfProfile *profile);
+// the tests of a discovery the filter accepts, keeping their order
+DiscoveredTests filter_tests(const DiscoveredTests &all, const TestFilter &filter);
+
+#endif
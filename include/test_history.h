@@ -0,0 +1,40 @@
+#ifndef PINCHECK_TEST_HISTORY_H
+#define PINCHECK_TEST_HISTORY_H
+
+#include <unordered_map>
+#include "common.h"
+#include "test_case.h"
+#include "test_result.h"
+
+struct HistoryEntry {
+  unsigned runs;
+  double mean_sec; // exponentially weighted
+  double last_sec;
+  double cpu_sec;  // exponentially weighted user+sys time of the process tree
+
+  HistoryEntry();
+};
+
+// Recorded durations of each test, kept in history.pincheck of the build
+// directory. A persistence pair is recorded once, under the base test.
+class TestHistory {
+private:
+  std::unordered_map<String, HistoryEntry> entries;
+  Path file;
+
+public:
+  explicit TestHistory(Path file);
+
+  const HistoryEntry *find(const String &full_name) const;
+  // recorded mean; otherwise the mean of all recorded tests, otherwise TIMEOUT
+  double estimate_sec(const TestCase &testcase) const;
+  // share of the duration spent on CPU, 1 if unknown
+  double cpu_share(const TestCase &testcase) const;
+  size_t size() const;
+
+  // the first result of a runner; the base test for a persistence pair
+  void record(const TestResult &result);
+  void save() const;
+};
+
+#endif
@@ -15,6 +15,12 @@ struct TestPath {
 Path detect_src(TestPath &paths);
 String detect_project(TestPath &paths);
 Path detect_build(TestPath &paths, bool verbose, bool clean);
+// make of the project with the given jobs, setting paths.build; unlike
+// detect_build, a failure is returned with the output of make
+bool make_build(TestPath &paths, unsigned jobs, String &output);
 Path make_pool(TestPath &paths, size_t size);
+// build directories the cwd may stand for, as detect_project sees it,
+// without running make: cwd itself, its build, and that of the project
+Vector<Path> guess_builds(const Path &cwd, const String &project);
 
 #endif
\ No newline at end of file
@@ -4,8 +4,11 @@
 #include <deque>
 #include <atomic>
 #include <chrono>
+#include <ostream>
 #include "common.h"
 #include "test_case.h"
+#include "execution.h"
+#include "kernel_stats.h"
 
 class TestResult {
   public:
@@ -16,10 +19,31 @@ class TestResult {
     const char* except_dump;
     std::chrono::system_clock::time_point start_time, end_time;
 
-    TestResult(const TestCase&, bool passed, int exit_code, const String& dump, const char* except_dump,
+    // profile of the process tree; run phase is make .output (launcher
+    // and qemu), check phase is make .result (.ck), the rest is overhead
+    ResourceUsage usage;
+    double run_sec, check_sec;
+
+    // power-off statistics of the kernel, and those of the last run if any
+    KernelStats kernel;
+    Optional<KernelStats> kernel_prev;
+
+    TestResult(const TestCase&, bool passed, int exit_code, String dump, const char* except_dump,
       std::chrono::system_clock::time_point start_time,
       std::chrono::system_clock::time_point end_time);
-    void print_row(bool detail, bool verbose) const;
+
+    // dumps can be large; results are only moved along
+    TestResult(const TestResult&) = delete;
+    TestResult& operator=(const TestResult&) = delete;
+    TestResult(TestResult&&) = default;
+    TestResult& operator=(TestResult&&) = default;
+
+    void print_row(std::ostream &os, bool detail, bool verbose) const;
+
+    const char *status() const; // "pass", "fail" or "error"
+    String reason() const;      // failure reason from the dump; empty if passed
+    double duration_sec() const;
+    double overhead_sec() const;
 };
 
 
@@ -2,12 +2,17 @@
 #define PINCHECK_TEST_RUNNER_H
 
 #include <mutex>
+#include <atomic>
 #include <future>
 #include <chrono>
 #include "test_case.h"
 #include "test_path.h"
 #include "test_result.h"
 #include "common.h"
+#include "execution.h"
+#include "kernel_stats.h"
+
+class RemoteSlot;
 
 class TestRunner {
 private:
@@ -16,10 +21,15 @@ private:
   int exit_code, exit_code_pers;
   String dump, dump_pers;
   const char* except_dump;
+  ResourceUsage usage;
+  double run_sec, check_sec;
+  KernelStats kernel, kernel_pers;
 
   std::chrono::system_clock::time_point start_time, end_time;
   std::future<void> fut;
   std::mutex mut;
+  std::atomic<bool> cancelled;
+  SpawnedProcess process;
 
   TestRunner(const TestRunner&) = delete;
   TestRunner& operator=(const TestRunner&) = delete;
@@ -39,8 +49,17 @@ public:
   String get_dump();
   const char *get_except_dump();
 
-  void register_test(const TestPath& paths) noexcept;
-  String get_print();
+  // with a remote slot, the run phase goes to its worker unless the test
+  // is a persistence pair; it runs here if the worker cannot take it
+  void register_test(const TestPath& paths, bool keep_dump, RemoteSlot *remote = nullptr) noexcept;
+  // kills the local processes of the test, which finishes as failed; a
+  // remote run is not stopped, but its result is dropped
+  void cancel();
+  // seconds since the test started, 0 if not yet
+  double get_elapsed_sec();
+  // the name with the elapsed time, and the expected one if given
+  String get_print(Optional<double> expected_sec = std::nullopt);
+  // moves the dumps out; call once after finished
   Vector<TestResult> get_results();
 };
 
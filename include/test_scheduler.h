@@ -0,0 +1,45 @@
+#ifndef PINCHECK_TEST_SCHEDULER_H
+#define PINCHECK_TEST_SCHEDULER_H
+
+#include "common.h"
+#include "test_case.h"
+#include "test_history.h"
+
+enum class TestOrder {
+  make,    // as listed by Make.tests
+  timeout, // decreasing TIMEOUT
+  history  // decreasing recorded duration (longest processing time first)
+};
+
+Optional<TestOrder> parse_test_order(const String &s);
+const char *test_order_name(TestOrder order);
+void order_tests(Vector<TestCase> &tests, TestOrder order, const TestHistory *history);
+
+// The dispatching rule of check_run: persistence tests run one at a time
+// and take precedence over the others whenever none of them is running.
+class TestQueue {
+private:
+  const Vector<TestCase> &target_tests, &persistence_tests;
+  // indices into the tests, in the order they are popped
+  Vector<size_t> order, order_pers;
+  size_t next, next_pers;
+
+public:
+  TestQueue(const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests);
+
+  bool empty() const;
+  // the number of tests not popped yet
+  size_t size() const;
+  // whether pop would give a test
+  bool can_pop(bool persistence_running) const;
+  // the test for a free slot, or nullptr if none can be dispatched now
+  const TestCase *pop(bool persistence_running);
+
+  // the tests not popped yet; the persistence ones first
+  Vector<const TestCase*> pending() const;
+  // moves a test not popped yet to the front of its queue; false if there
+  // is none of the given full name
+  bool bump(const String &full_name);
+};
+
+#endif
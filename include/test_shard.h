@@ -0,0 +1,27 @@
+#ifndef PINCHECK_TEST_SHARD_H
+#define PINCHECK_TEST_SHARD_H
+
+#include "common.h"
+#include "test_case.h"
+#include "test_history.h"
+
+struct ShardSpec {
+  unsigned index; // 1..count
+  unsigned count;
+};
+
+// "i/n"
+Optional<ShardSpec> parse_shard(const String &s);
+
+// Keeps the tests of one shard. Tests are dealt longest first to the least
+// loaded shard, by the estimate of history or by TIMEOUT without one; ties
+// go by name and by shard number, so every worker given the same tests and
+// history agrees. Returns the predicted seconds of each shard.
+Vector<double> select_shard(Vector<TestCase> &target_tests, Vector<TestCase> &persistence_tests,
+  const ShardSpec &shard, const TestHistory *history);
+
+// Combines the --report-json files of the shards into one summary, and
+// into out if given; fails if any test failed.
+int merge_shards(const Vector<Path> &files, const Optional<Path> &out);
+
+#endif
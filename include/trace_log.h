@@ -0,0 +1,47 @@
+#ifndef PINCHECK_TRACE_LOG_H
+#define PINCHECK_TRACE_LOG_H
+
+#include <mutex>
+#include <chrono>
+#include "common.h"
+
+// Collects spans of a run and writes them in the Chrome trace event
+// format, viewable with chrome://tracing or ui.perfetto.dev.
+// Track 0 is pincheck itself; track i+1 is the pool slot i.
+class TraceLog {
+private:
+  struct Event {
+    String name, category;
+    unsigned tid;
+    long long ts_us, dur_us;
+    String args; // JSON object, may be empty
+  };
+
+  Vector<Event> events;
+  std::mutex mut;
+  std::chrono::system_clock::time_point origin;
+  unsigned max_tid;
+
+public:
+  TraceLog();
+
+  void span(const String &name, const String &category, unsigned tid,
+    std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end,
+    String args = {});
+  void write(const Path &file);
+};
+
+// Records a span on track 0 from its construction to its destruction.
+// Does nothing if log is nullptr.
+class TraceScope {
+private:
+  TraceLog *log;
+  String name;
+  std::chrono::system_clock::time_point start;
+
+public:
+  TraceScope(TraceLog *log, String name);
+  ~TraceScope();
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef PINCHECK_TREE_WATCH_H
+#define PINCHECK_TREE_WATCH_H
+
+#include <chrono>
+#include <unordered_map>
+#include "common.h"
+
+// how long saves have to stop before a burst of them counts as one change
+constexpr auto WATCH_DEBOUNCE = std::chrono::milliseconds(300);
+
+// Files written under a source tree, through inotify. Build directories,
+// hidden files and editor backups are not watched; new directories are.
+class TreeWatch {
+private:
+  int fd;
+  Path root;
+  std::unordered_map<int, Path> dirs; // by watch descriptor
+
+  TreeWatch(const TreeWatch&) = delete;
+  TreeWatch& operator=(const TreeWatch&) = delete;
+
+  void add_tree(const Path &dir);
+  // reads the pending events into changed; false if none came in timeout_ms
+  bool read_events(int timeout_ms, Vector<Path> &changed);
+
+public:
+  explicit TreeWatch(Path root);
+  ~TreeWatch() noexcept;
+
+  // Waits up to timeout, or without limit, for a change, then until saves
+  // stop for WATCH_DEBOUNCE. The changed files relative to the root; empty
+  // on timeout or on a signal.
+  Vector<Path> wait(Optional<std::chrono::milliseconds> timeout);
+};
+
+#endif
@@ -0,0 +1,213 @@
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <map>
+#include <cmath>
+
+#include "ab_runner.h"
+#include "baseline.h"
+#include "check_runner.h"
+#include "kernel_stats.h"
+#include "status_renderer.h"
+#include "test_runner.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+constexpr std::array<const char*, 2> SIDE_NAMES = {"A", "B"};
+
+AbOption::AbOption()
+: is_verbose(false)
+, pool_size(1), rounds(3) {}
+
+namespace {
+
+struct AbJob {
+  size_t side;
+  const TestCase *testcase;
+  unsigned round;
+};
+
+// samples[round][side] of one metric of one test
+using AbSamples = Vector<std::array<Optional<double>, 2>>;
+
+}
+
+// two-sided 95% critical value of Student's t
+static double t_critical(unsigned df) {
+  constexpr std::array<double, 30> table = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+  };
+  if(df == 0) return 0;
+  return df <= table.size() ? table[df - 1] : 1.96;
+}
+
+static bool is_ab_metric(const String &name) {
+  return name == DURATION_METRIC || name == "timer_ticks" || is_efficiency_counter(name);
+}
+
+int ab_run(const TestPath &a, const TestPath &b,
+  const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests,
+  const AbOption &opt) {
+  const std::array<const TestPath*, 2> sides = {&a, &b};
+  const auto pool_size = opt.pool_size;
+
+  Deque<AbJob> jobs;
+  for(unsigned round = 0; round < opt.rounds; ++round) {
+    for(const auto *tests : {&persistence_tests, &target_tests}) {
+      for(const auto &t : *tests) {
+        const size_t first = round % 2;
+        jobs.push_back(AbJob{first, &t, round});
+        jobs.push_back(AbJob{1 - first, &t, round});
+      }
+    }
+  }
+  const auto total_jobs = jobs.size();
+
+  std::cout << termcolor::bold << "A/B of " << (target_tests.size() + persistence_tests.size())
+    << " tests, " << opt.rounds << " rounds" << termcolor::reset << std::endl;
+  for(size_t s = 0; s < sides.size(); ++s) {
+    std::cout << SIDE_NAMES[s] << ": " << String{sides[s]->build} << std::endl;
+  }
+  std::cout << std::endl;
+
+  std::map<String, std::map<String, AbSamples>> samples;
+  std::map<String, std::array<unsigned, 2>> failures;
+
+  Vector<std::unique_ptr<TestRunner>> pool(pool_size);
+  Vector<Optional<AbJob>> pool_jobs(pool_size);
+  size_t finished = 0;
+  StatusRenderer renderer;
+  auto &rows = renderer.row_stream();
+  while(finished < total_jobs) {
+    for(size_t i = 0; i < pool_size; ++i) {
+      if(!pool[i] || !pool[i]->is_finished()) continue;
+      const auto job = *pool_jobs[i];
+      for(auto &r : pool[i]->get_results()) {
+        const auto name = r.testcase.full_name();
+        rows << termcolor::bold << SIDE_NAMES[job.side] << termcolor::reset << ' ';
+        r.print_row(rows, opt.is_verbose, opt.is_verbose);
+        rows << '\n';
+
+        if(!r.passed) {
+          ++failures[name][job.side];
+          continue;
+        }
+        auto record = [&](const String &metric, double value) {
+          auto &s = samples[name][metric];
+          s.resize(opt.rounds);
+          s[job.round][job.side] = value;
+        };
+        record(DURATION_METRIC, r.duration_sec());
+        for(const auto &[counter, value] : r.kernel.counters) {
+          if(is_ab_metric(counter)) record(counter, value);
+        }
+      }
+      pool[i] = nullptr;
+      pool_jobs[i].reset();
+      ++finished;
+    }
+
+    bool persistence_running = std::any_of(pool.cbegin(), pool.cend(),
+      [](const std::unique_ptr<TestRunner>& p){return p && p->get_test_case().persistence;});
+    for(size_t i = 0; i < pool_size && !jobs.empty(); ++i) {
+      if(pool[i]) continue;
+      // the next job, skipping persistence tests while one of them runs
+      const auto it = std::find_if(jobs.begin(), jobs.end(), [persistence_running](const AbJob &j) {
+        return !persistence_running || !j.testcase->persistence;
+      });
+      if(it == jobs.end()) break;
+
+      pool_jobs[i] = *it;
+      pool[i] = std::make_unique<TestRunner>(*it->testcase);
+      pool[i]->register_test(*sides[it->side], opt.is_verbose);
+      persistence_running = persistence_running || it->testcase->persistence;
+      jobs.erase(it);
+    }
+
+    renderer.render(pool);
+    std::this_thread::sleep_for(CHECK_POLL_INTERVAL);
+  }
+  renderer.clear();
+
+  // paired differences B - A of the rounds where both passed
+  std::cout << std::endl << termcolor::bold << "-- A/B differences (B - A), 95% CI --" << termcolor::reset << std::endl;
+  std::cout << std::left << std::setw(36) << "test" << std::setw(16) << "metric" << std::right
+    << std::setw(10) << "A" << std::setw(10) << "B" << std::setw(10) << "B - A"
+    << std::setw(24) << "95% CI" << std::setw(4) << "n" << std::endl;
+
+  std::map<unsigned, std::array<double, 2>> round_totals;
+  std::map<unsigned, unsigned> round_counts;
+  size_t significant = 0;
+  for(const auto &[test, metrics] : samples) {
+    bool first_row = true;
+    for(const auto &[metric, rounds] : metrics) {
+      SampleStats sa, sb, diff;
+      for(unsigned round = 0; round < rounds.size(); ++round) {
+        const auto &pair = rounds[round];
+        if(!pair[0] || !pair[1]) continue;
+        sa.add(*pair[0]);
+        sb.add(*pair[1]);
+        diff.add(*pair[1] - *pair[0]);
+        if(metric == DURATION_METRIC) {
+          round_totals[round][0] += *pair[0];
+          round_totals[round][1] += *pair[1];
+          ++round_counts[round];
+        }
+      }
+      // unchanged counters are left out; the duration always shows
+      if(diff.n == 0 || (metric != DURATION_METRIC && diff.mean == 0 && diff.stddev() == 0)) continue;
+
+      const bool is_duration = metric == DURATION_METRIC;
+      const int digits = is_duration ? 2 : 1;
+      const auto half = t_critical(diff.n - 1) * diff.stddev() / std::sqrt(diff.n);
+      const bool is_significant = diff.n > 1 && (diff.mean - half > 0 || diff.mean + half < 0);
+      significant += is_significant;
+
+      std::cout << std::left << std::setw(36) << (first_row ? test : "") << std::setw(16) << metric << std::right
+        << std::setw(10) << format_fixed(sa.mean, digits)
+        << std::setw(10) << format_fixed(sb.mean, digits);
+      if(is_significant) {
+        std::cout << (diff.mean < 0 ? termcolor::green : termcolor::red);
+      }
+      std::cout << std::setw(10) << format_fixed(diff.mean, digits) << termcolor::reset;
+      if(diff.n > 1) {
+        std::cout << std::setw(24) << ("[" + format_fixed(diff.mean - half, digits) + ", " + format_fixed(diff.mean + half, digits) + "]");
+      } else {
+        std::cout << std::setw(24) << "-";
+      }
+      std::cout << std::setw(4) << diff.n << std::endl;
+      first_row = false;
+    }
+  }
+
+  // sum of the durations of the tests that passed on both, per round
+  SampleStats total_diff, total_a, total_b;
+  for(const auto &[round, totals] : round_totals) {
+    total_a.add(totals[0]);
+    total_b.add(totals[1]);
+    total_diff.add(totals[1] - totals[0]);
+  }
+  if(total_diff.n > 0) {
+    const auto half = t_critical(total_diff.n - 1) * total_diff.stddev() / std::sqrt(total_diff.n);
+    std::cout << std::endl << termcolor::bold << "Total duration per round: A " << format_fixed(total_a.mean, 2)
+      << "s, B " << format_fixed(total_b.mean, 2) << "s, B - A " << format_fixed(total_diff.mean, 2) << "s"
+      << termcolor::reset;
+    if(total_diff.n > 1) {
+      std::cout << " [" << format_fixed(total_diff.mean - half, 2) << ", " << format_fixed(total_diff.mean + half, 2) << "]";
+    }
+    std::cout << std::endl;
+  }
+  std::cout << significant << " differences exclude 0 from their 95% CI." << std::endl;
+
+  int return_value = 0;
+  if(!failures.empty()) {
+    std::cout << std::endl << termcolor::red << "-- Failures (A/B) --" << termcolor::reset << std::endl;
+    for(const auto &[test, counts] : failures) {
+      std::cout << test << ": " << counts[0] << "/" << counts[1] << std::endl;
+    }
+    return_value = 1;
+  }
+  return return_value;
+}
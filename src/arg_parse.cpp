@@ -5,7 +5,7 @@ void parse_args(argparse::ArgumentParser &program, int argc, char *argv[]){
   std::ostringstream panic_msg;
 
   program.add_argument("-p", "--project")
-         .help("Pintos project to run test; threads, userprog, vm, or filesys");
+         .help("Pintos project to run test; threads, userprog, vm, or filesys; all or a comma-separated list runs them in one pool");
   program.add_argument("-j", "--jobs")
          .help("Maximum number of parallel test execution")
          .scan<'i', unsigned>()
@@ -38,6 +38,13 @@ void parse_args(argparse::ArgumentParser &program, int argc, char *argv[]){
          .help("Sort test cases first in decreasing order of TIMEOUT, which may help to check all faster")
          .default_value(false)
          .implicit_value(true);
+  program.add_argument("--order")
+         .help("Order of test cases; make (as listed), timeout (same as --sort), or history (longest recorded duration first)")
+         .default_value(String{"make"});
+  program.add_argument("--simulate")
+         .help("Simulate the run for a range of -j and orders with recorded durations, and recommend -j")
+         .default_value(false)
+         .implicit_value(true);
   program.add_argument("-jr", "--just-run")
          .help("Run a case getting the output; only one at a time is required");
   program.add_argument("-gr", "--gdb-run")
@@ -46,6 +53,94 @@ void parse_args(argparse::ArgumentParser &program, int argc, char *argv[]){
          .help("# of repeating the whole checking")
          .scan<'i', unsigned>()
          .default_value(static_cast<unsigned>(1));
+  program.add_argument("--repeat-until-fail")
+         .help("Repeat the whole checking until an epoch fails; aggregates results to keep memory constant")
+         .default_value(false)
+         .implicit_value(true);
+  program.add_argument("--soak")
+         .help("Repeat the whole checking for the given duration (e.g. 90m, 8h, 2d); aggregates results to keep memory constant");
+  program.add_argument("--soak-dir")
+         .help("Directory to keep failing outputs of soak mode; default is soak.pincheck in the build directory");
+  program.add_argument("--report-json")
+         .help("Write one JSON object per finished test to the given file, as tests finish");
+  program.add_argument("--junit")
+         .help("Write JUnit XML results to the given file");
+  program.add_argument("--trace")
+         .help("Write a Chrome trace event timeline of the run to the given file (chrome://tracing, ui.perfetto.dev)");
+  program.add_argument("--baseline")
+         .help("save: keep wall times and kernel counters of a passing run as the baseline; compare: flag regressions against it");
+  program.add_argument("--baseline-file")
+         .help("File of the baseline; default is baseline.pincheck in the build directory");
+  program.add_argument("--baseline-fail")
+         .help("Exit with nonzero code if --baseline compare finds a regression")
+         .default_value(false)
+         .implicit_value(true);
+  program.add_argument("--ab")
+         .help("A/B mode; run the tests alternately on this build (A) and another pintos src, project or build directory (B)");
+  program.add_argument("--ab-rev")
+         .help("A/B mode with B built from the given git revision, checked out as a worktree in the build directory");
+  program.add_argument("--ab-rounds")
+         .help("Rounds of A/B mode; each round runs every test once on each side")
+         .scan<'i', unsigned>()
+         .default_value(static_cast<unsigned>(3));
+  program.add_argument("--bisect")
+         .help("Find the first revision in <good>..<bad> failing the selected tests; -j revisions are built and tested at once in git worktrees");
+  program.add_argument("--bisect-repeat")
+         .help("Runs of the tests on each revision in --bisect; a revision is bad if any run fails")
+         .scan<'i', unsigned>()
+         .default_value(static_cast<unsigned>(1));
+  program.add_argument("--batch")
+         .help("Grade many pintos trees of the project given by -p in one pool; a src directory, or a file listing them one per line; can be given multiple times")
+         .append();
+  program.add_argument("--batch-builds")
+         .help("Trees built at once in --batch")
+         .scan<'i', unsigned>()
+         .default_value(static_cast<unsigned>(2));
+  program.add_argument("--batch-report")
+         .help("Write one JSON object per tree of --batch to the given file, as trees finish");
+  program.add_argument("--shard")
+         .help("Run only shard i of n (as i/n) of the tests, balanced by the durations of --shard-history, or by TIMEOUT without it");
+  program.add_argument("--shard-history")
+         .help("history.pincheck to balance --shard by; every shard must be given the same one");
+  program.add_argument("--merge")
+         .help("Combine the --report-json files of shards into one summary and exit code; takes the rest of the arguments")
+         .remaining();
+  program.add_argument("--remote")
+         .help("[host:]port of a pincheck --worker to run tests on, besides the -j local ones; can be given multiple times")
+         .append();
+  program.add_argument("--worker")
+         .help("Serve as a worker for --remote on the given [host:]port, running tests with the pintos in PATH; only on 127.0.0.1 without a host");
+  program.add_argument("--worker-token")
+         .help("Secret a worker and its --remote coordinators share; default is $PINCHECK_WORKER_TOKEN");
+  program.add_argument("--worker-slots")
+         .help("Tests a worker runs at once")
+         .scan<'i', unsigned>()
+         .default_value(HARDWARE_CONCURRENCY);
+  program.add_argument("--worker-cache")
+         .help("Directory a worker keeps files in by content hash; default is pincheck-worker in ~/.cache");
+  program.add_argument("--control")
+         .help("Send a command to the check session running in this project and print the answer: list, cancel <test>, bump <test>, slots <n>, summary or stop");
+  program.add_argument("--watch")
+         .help("Check the selected tests again, failures first, whenever the sources change; a run made obsolete by a change is cancelled")
+         .default_value(false)
+         .implicit_value(true);
+  program.add_argument("--daemon")
+         .help("Keep this project built and its tests discovered, serving later pincheck runs in its directory until stopped")
+         .default_value(false)
+         .implicit_value(true);
+  program.add_argument("--no-daemon")
+         .help("Run here even if a --daemon serves this project")
+         .default_value(false)
+         .implicit_value(true);
+  program.add_argument("--metrics")
+         .help("Keep Prometheus metrics of the run in the given file, replaced every second, for the textfile collector of node_exporter");
+  program.add_argument("--metrics-port")
+         .help("Serve Prometheus metrics of the run over HTTP on 127.0.0.1 at the given port")
+         .scan<'i', unsigned>();
+  program.add_argument("--self-profile")
+         .help("Report wall and CPU time spent in each phase of pincheck itself, and the processes it spawned")
+         .default_value(false)
+         .implicit_value(true);
   program.add_argument("--gdb")
          .help("Run with --gdb option for pintos; used with --just-run")
          .default_value(false)
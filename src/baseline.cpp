@@ -0,0 +1,155 @@
+#include <fstream>
+#include <cmath>
+
+#include "baseline.h"
+#include "execution.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+// A metric regressed when its mean exceeds the baseline by BASELINE_SIGMA
+// standard errors of the difference, and also by the relative and absolute
+// floors; with one sample on each side only the floors apply.
+constexpr double BASELINE_SIGMA = 3;
+constexpr double DURATION_REL_FLOOR = 0.5, DURATION_ABS_FLOOR = 1.0;
+constexpr double COUNTER_REL_FLOOR = 0.2, COUNTER_ABS_FLOOR = 5;
+
+Optional<BaselineMode> parse_baseline_mode(const String &s) {
+  if(s == "save") return BaselineMode::save;
+  if(s == "compare") return BaselineMode::compare;
+  return std::nullopt;
+}
+
+SampleStats::SampleStats()
+: n(0), mean(0), m2(0) {}
+
+void SampleStats::add(double x) {
+  ++n;
+  const auto delta = x - mean;
+  mean += delta / n;
+  m2 += delta * (x - mean);
+}
+
+double SampleStats::stddev() const {
+  return n > 1 ? std::sqrt(m2 / (n - 1)) : 0;
+}
+
+static bool regressed(const String &metric, const SampleStats &before, const SampleStats &after) {
+  const bool is_duration = metric == DURATION_METRIC;
+  const auto rel = is_duration ? DURATION_REL_FLOOR : COUNTER_REL_FLOOR;
+  const auto abs = is_duration ? DURATION_ABS_FLOOR : COUNTER_ABS_FLOOR;
+
+  const auto diff = after.mean - before.mean;
+  const auto se = std::sqrt(std::pow(before.stddev(), 2) / before.n + std::pow(after.stddev(), 2) / after.n);
+  return diff > BASELINE_SIGMA * se && diff > rel * before.mean && diff >= abs;
+}
+
+Baseline::Baseline()
+: tests() {}
+
+Baseline Baseline::load(const Path &file) {
+  std::ostringstream panic_msg;
+  std::ifstream baseline_fs{file};
+  if(!baseline_fs.is_open()) {
+    panic_msg << "Cannot read the baseline " << file << "; make one with --baseline save first.";
+    panic(panic_msg);
+  }
+
+  Baseline ret;
+  String line;
+  while(std::getline(baseline_fs, line)) {
+    const auto tokens = string_tokenize(line);
+    if(tokens.size() != 5) {
+      continue;
+    }
+
+    SampleStats s;
+    double stddev;
+    try {
+      s.n = std::stoul(tokens[2]);
+      s.mean = std::stod(tokens[3]);
+      stddev = std::stod(tokens[4]);
+    } catch (std::exception&) {
+      continue;
+    }
+    if(s.n == 0) continue;
+    s.m2 = stddev * stddev * (s.n - 1);
+    ret.tests[tokens[0]][tokens[1]] = s;
+  }
+  return ret;
+}
+
+void Baseline::save(const Path &file) const {
+  std::ostringstream panic_msg;
+  std::ofstream baseline_fs{file};
+  if(!baseline_fs.is_open()) {
+    panic_msg << "Cannot write the baseline " << file;
+    panic(panic_msg);
+  }
+  for(const auto &[test, metrics] : tests) {
+    for(const auto &[metric, s] : metrics) {
+      baseline_fs << test << ' ' << metric << ' ' << s.n << ' '
+        << format_fixed(s.mean, 3) << ' ' << format_fixed(s.stddev(), 3) << '\n';
+    }
+  }
+}
+
+void Baseline::add(const TestResult &result) {
+  if(!result.passed) return;
+  auto &metrics = tests[result.testcase.full_name()];
+  metrics[DURATION_METRIC].add(result.duration_sec());
+  for(const auto &[name, value] : result.kernel.counters) {
+    if(is_efficiency_counter(name)) {
+      metrics[name].add(value);
+    }
+  }
+}
+
+size_t Baseline::size() const {
+  return tests.size();
+}
+
+size_t Baseline::overlap(const Baseline &current) const {
+  return std::count_if(current.tests.cbegin(), current.tests.cend(),
+    [this](const auto &t){return tests.count(t.first) != 0;});
+}
+
+Vector<BaselineRegression> Baseline::compare(const Baseline &current) const {
+  Vector<BaselineRegression> ret;
+  for(const auto &[test, metrics] : current.tests) {
+    const auto it = tests.find(test);
+    if(it == tests.end()) continue;
+    for(const auto &[metric, after] : metrics) {
+      const auto base_it = it->second.find(metric);
+      if(base_it == it->second.end()) continue;
+      if(regressed(metric, base_it->second, after)) {
+        ret.push_back(BaselineRegression{test, metric, base_it->second, after});
+      }
+    }
+  }
+  std::sort(ret.begin(), ret.end(), [](const BaselineRegression &a, const BaselineRegression &b) {
+    return a.test < b.test || (a.test == b.test && a.metric < b.metric);
+  });
+  return ret;
+}
+
+void print_regressions(std::ostream &os, const Vector<BaselineRegression> &regressions, size_t compared) {
+  os << termcolor::bold << "-- Baseline comparison --" << termcolor::reset << std::endl;
+  for(const auto &r : regressions) {
+    const bool is_duration = r.metric == DURATION_METRIC;
+    const int digits = is_duration ? 2 : 0;
+    const char *unit = is_duration ? "s" : "";
+    os << termcolor::red << r.test << termcolor::reset << ": " << r.metric << " "
+      << format_fixed(r.before.mean, digits) << unit << " -> " << termcolor::bold
+      << format_fixed(r.after.mean, digits) << unit << termcolor::reset;
+    if(r.before.mean > 0) {
+      os << " (x" << format_fixed(r.after.mean / r.before.mean, 2) << ")";
+    }
+    os << termcolor::bright_grey << " baseline n=" << r.before.n << " sd " << format_fixed(r.before.stddev(), digits)
+      << ", now n=" << r.after.n << " sd " << format_fixed(r.after.stddev(), digits) << termcolor::reset << std::endl;
+  }
+  if(regressions.empty()) {
+    os << termcolor::green << "No regression in " << compared << " tests." << termcolor::reset << std::endl;
+  } else {
+    os << termcolor::red << regressions.size() << " regressions in " << compared << " tests." << termcolor::reset << std::endl;
+  }
+}
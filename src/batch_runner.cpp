@@ -0,0 +1,272 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <future>
+#include <thread>
+
+#include "batch_runner.h"
+#include "check_runner.h"
+#include "test_scheduler.h"
+#include "status_renderer.h"
+#include "test_runner.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+BatchOption::BatchOption()
+: is_verbose(false)
+, pool_size(1), builds(1)
+, filter(), report_json()
+, unit_name("tree")
+, metrics(nullptr) {}
+
+namespace {
+
+struct Prepared {
+  TestPath paths;
+  bool built; // and its tests listed
+  String error;
+  DiscoveredTests tests;
+  double discovery_sec;
+};
+
+struct UnitState {
+  Optional<std::future<Prepared>> preparing;
+  Optional<Prepared> prepared;
+  Optional<TestQueue> queue;
+  bool done;
+  unsigned running;
+  bool persistence_running;
+  unsigned pass, fail;
+  std::unordered_set<String> passed;
+  Vector<String> failed;
+  std::chrono::system_clock::time_point start_time, end_time;
+
+  UnitState()
+  : done(false), running(0), persistence_running(false)
+  , pass(0), fail(0) {}
+
+  double score() const {
+    double ret = 0;
+    for(const auto &rubric : prepared->tests.rubrics) {
+      ret += rubric_score(rubric, passed);
+    }
+    return ret;
+  }
+  double elapsed_sec() const {
+    return std::chrono::duration<double>(end_time - start_time).count();
+  }
+};
+
+}
+
+static Prepared prepare_unit(TestPath paths, unsigned jobs, const TestFilter &filter) {
+  Prepared ret{std::move(paths), false, {}, {}, 0};
+  if(!fs::is_directory(ret.paths.src / ret.paths.project)) {
+    ret.error = "no " + ret.paths.project + " directory";
+    return ret;
+  }
+  if(!make_build(ret.paths, jobs, ret.error)) {
+    return ret;
+  }
+  // a tree whose tests cannot be listed, as without its Rubric, fails alone
+  PanicScope panic_scope;
+  try {
+    const auto start = std::chrono::steady_clock::now();
+    ret.tests = discover_tests(ret.paths, filter, nullptr);
+    ret.discovery_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } catch(const PanicError &e) {
+    ret.error = e.what();
+    return ret;
+  }
+  ret.built = true;
+  return ret;
+}
+
+// the first line of make output telling an error, otherwise the first line
+static String error_line(const String &error) {
+  std::istringstream is{error};
+  String line, first;
+  while(std::getline(is, line)) {
+    if(first.empty()) first = line;
+    if(line.find("error") != String::npos && line.find("make") != 0) return string_trim(line);
+  }
+  return string_trim(first);
+}
+
+static void print_unit(std::ostream &os, const BatchUnit &unit, const UnitState &state, size_t label_width) {
+  os << std::left << std::setw(label_width) << unit.label << std::right;
+  if(!state.prepared->built) {
+    os << termcolor::red << std::setw(8) << "error" << termcolor::reset
+      << termcolor::bright_grey << "  " << error_line(state.prepared->error).substr(0, 200)
+      << termcolor::reset << '\n';
+    return;
+  }
+  os << std::setw(8) << state.pass
+    << (state.fail ? termcolor::red : termcolor::reset) << std::setw(6) << state.fail << termcolor::reset
+    << termcolor::bold << std::setw(9) << format_fixed(state.score(), 1) << termcolor::reset
+    << std::setw(9) << format_fixed(state.elapsed_sec(), 1) << '\n';
+}
+
+int batch_run(const Vector<BatchUnit> &units, const BatchOption &opt) {
+  std::ostringstream panic_msg;
+  const auto pool_size = opt.pool_size;
+  const auto builds = std::max(1u, opt.builds);
+  const auto build_jobs = std::max(1u, HARDWARE_CONCURRENCY / builds);
+
+  Optional<std::ofstream> report;
+  if(opt.report_json) {
+    report.emplace(*opt.report_json);
+    if(!report->is_open()) {
+      panic_msg << "Cannot open " << *opt.report_json;
+      panic(panic_msg);
+    }
+  }
+
+  size_t label_width = 12;
+  for(const auto &u : units) {
+    label_width = std::max(label_width, std::min<size_t>(u.label.size() + 2, 48));
+  }
+
+  std::cout << termcolor::bold << "Batch of " << units.size() << " " << opt.unit_name << "s, "
+    << builds << " builds and " << pool_size << " tests at once" << termcolor::reset << std::endl << std::endl;
+  std::cout << std::left << std::setw(label_width) << opt.unit_name << std::right
+    << std::setw(8) << "pass" << std::setw(6) << "fail" << std::setw(9) << "score" << std::setw(9) << "sec" << std::endl;
+
+  Vector<UnitState> states(units.size());
+  size_t next_build = 0, done = 0;
+  unsigned building = 0;
+
+  Vector<std::unique_ptr<TestRunner>> pool(pool_size);
+  Vector<size_t> pool_units(pool_size);
+  StatusRenderer renderer;
+  auto &rows = renderer.row_stream();
+
+  const auto finish_unit = [&](size_t u) {
+    auto &state = states[u];
+    state.done = true;
+    state.end_time = std::chrono::system_clock::now();
+    ++done;
+    print_unit(rows, units[u], state, label_width);
+    if(report) {
+      *report << "{\"tree\":\"" << json_escape(units[u].label) << '"'
+        << ",\"project\":\"" << units[u].paths.project << '"'
+        << ",\"built\":" << (state.prepared->built ? "true" : "false");
+      if(state.prepared->built) {
+        *report << ",\"pass\":" << state.pass << ",\"fail\":" << state.fail
+          << ",\"score\":" << format_fixed(state.score(), 2)
+          << ",\"failed\":[";
+        for(size_t i = 0; i < state.failed.size(); ++i) {
+          *report << (i ? "," : "") << '"' << json_escape(state.failed[i]) << '"';
+        }
+        *report << ']';
+      } else {
+        *report << ",\"error\":\"" << json_escape(state.prepared->error) << '"';
+      }
+      *report << ",\"sec\":" << format_fixed(state.elapsed_sec(), 2) << "}\n" << std::flush;
+    }
+  };
+
+  while(done < units.size()) {
+    // builds, overlapping with the tests of the others
+    for(; building < builds && next_build < units.size(); ++next_build, ++building) {
+      auto &state = states[next_build];
+      state.start_time = std::chrono::system_clock::now();
+      state.preparing = std::async(std::launch::async, prepare_unit,
+        units[next_build].paths, build_jobs, std::cref(opt.filter));
+    }
+    for(size_t u = 0; u < units.size(); ++u) {
+      auto &state = states[u];
+      if(!state.preparing || state.preparing->wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+      state.prepared = state.preparing->get();
+      state.preparing.reset();
+      --building;
+      if(opt.metrics && state.prepared->built) opt.metrics->discovery(state.prepared->discovery_sec);
+      const auto &tests = state.prepared->tests;
+      state.queue.emplace(tests.target_tests, tests.persistence_tests);
+      if(state.queue->empty()) finish_unit(u);
+    }
+
+    for(size_t i = 0; i < pool_size; ++i) {
+      if(!pool[i] || !pool[i]->is_finished()) continue;
+      const auto u = pool_units[i];
+      auto &state = states[u];
+      const auto results = pool[i]->get_results();
+      if(opt.metrics) opt.metrics->finished(i, results);
+      for(const auto &r : results) {
+        if(opt.is_verbose) {
+          rows << termcolor::bold << units[u].label << termcolor::reset << ' ';
+          r.print_row(rows, false, false);
+          rows << '\n';
+        }
+        if(r.passed) {
+          ++state.pass;
+          state.passed.insert(r.testcase.full_name());
+        } else {
+          ++state.fail;
+          state.failed.push_back(r.testcase.full_name());
+        }
+      }
+      --state.running;
+      if(pool[i]->get_test_case().persistence) state.persistence_running = false;
+      pool[i] = nullptr;
+      if(state.running == 0 && state.queue->empty()) finish_unit(u);
+    }
+
+    // fair share: the unit with the fewest running tests, earlier first
+    for(size_t i = 0; i < pool_size; ++i) {
+      if(pool[i]) continue;
+      Optional<size_t> pick;
+      for(size_t u = 0; u < units.size(); ++u) {
+        const auto &state = states[u];
+        if(!state.queue || !state.queue->can_pop(state.persistence_running)) continue;
+        if(pick && states[*pick].running <= state.running) continue;
+        pick = u;
+      }
+      if(!pick) break;
+
+      auto &state = states[*pick];
+      const auto testcase = state.queue->pop(state.persistence_running);
+      pool_units[i] = *pick;
+      pool[i] = std::make_unique<TestRunner>(*testcase);
+      if(opt.metrics) opt.metrics->dispatched(i);
+      pool[i]->register_test(state.prepared->paths, opt.is_verbose);
+      ++state.running;
+      state.persistence_running = state.persistence_running || testcase->persistence;
+    }
+
+    if(opt.metrics) {
+      size_t running = 0, queued = 0;
+      for(const auto &state : states) {
+        running += state.running;
+        if(state.queue) queued += state.queue->size();
+      }
+      opt.metrics->pool(pool_size, running, queued);
+      opt.metrics->flush();
+    }
+
+    renderer.render(pool);
+    std::this_thread::sleep_for(CHECK_POLL_INTERVAL);
+  }
+  renderer.clear();
+  if(opt.metrics) opt.metrics->flush(true);
+
+  std::cout << std::endl;
+  if(opt.is_verbose) {
+    for(size_t u = 0; u < units.size(); ++u) {
+      if(states[u].failed.empty()) continue;
+      std::cout << termcolor::red << units[u].label << termcolor::reset << ":";
+      for(const auto &f : states[u].failed) std::cout << ' ' << f;
+      std::cout << std::endl;
+    }
+  }
+  size_t errors = 0;
+  unsigned pass = 0, fail = 0;
+  for(const auto &s : states) {
+    errors += !s.prepared->built;
+    pass += s.pass;
+    fail += s.fail;
+  }
+  std::cout << termcolor::bold << units.size() - errors << " of " << units.size() << " " << opt.unit_name << "s graded"
+    << termcolor::reset << "; Pass: " << pass << "\tFail: " << fail << std::endl;
+  return errors == 0 && fail == 0 ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+#include <iostream>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "bisect_runner.h"
+#include "check_runner.h"
+#include "execution.h"
+#include "git_worktree.h"
+#include "test_runner.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+namespace {
+
+enum class Verdict {
+  good, bad, skip
+};
+
+struct Candidate {
+  size_t index;
+  Verdict verdict;
+  String reason;
+  String description; // abbreviated hash and subject
+};
+
+}
+
+BisectOption::BisectOption()
+: slots(1), repeats(1) {}
+
+// runs the tests one by one; the first failure decides
+static bool run_tests(const TestPath &paths, const Vector<const TestCase*> &tests, unsigned repeats, String &reason) {
+  for(unsigned i = 0; i < repeats; ++i) {
+    for(const auto *t : tests) {
+      TestRunner runner(*t);
+      runner.register_test(paths, false);
+      while(!runner.is_finished()) {
+        std::this_thread::sleep_for(CHECK_POLL_INTERVAL);
+      }
+      for(const auto &r : runner.get_results()) {
+        if(!r.passed) {
+          reason = r.testcase.full_name() + ": " + r.status();
+          if(repeats > 1) reason += " on run " + std::to_string(i + 1);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Checks out, builds and tests one revision in the worktree of the slot.
+// Runs beside the others, so a panic of git or make skips the revision.
+static Candidate test_revision(const TestPath &paths, const String &commit, size_t index, size_t slot,
+  const Vector<const TestCase*> &tests, const BisectOption &opt, unsigned build_jobs, std::mutex &git_mut) {
+  Candidate c{index, Verdict::skip, {}, commit.substr(0, 12)};
+  PanicScope panic_scope;
+  try {
+    TestPath p;
+    p.project = paths.project;
+    {
+      // worktrees of one repository are checked out one at a time
+      std::unique_lock lock{git_mut};
+      c.description = describe_commit(paths.src, commit);
+      p.src = checkout_worktree(paths.src, commit,
+        paths.build / "bisect.pincheck" / ("slot" + std::to_string(slot)));
+    }
+
+    String output;
+    if(!make_build(p, build_jobs, output)) {
+      c.reason = "build failed";
+    } else {
+      c.verdict = run_tests(p, tests, opt.repeats, c.reason) ? Verdict::good : Verdict::bad;
+    }
+  } catch(const PanicError &e) {
+    c.verdict = Verdict::skip;
+    c.reason = string_trim(String{e.what()}.substr(0, String{e.what()}.find('\n')));
+  }
+  return c;
+}
+
+static void print_candidate(const Candidate &c) {
+  std::cout << "  ";
+  switch(c.verdict) {
+    case Verdict::good: std::cout << termcolor::green << "good "; break;
+    case Verdict::bad: std::cout << termcolor::red << "bad  "; break;
+    case Verdict::skip: std::cout << termcolor::yellow << "skip "; break;
+  }
+  std::cout << termcolor::reset << c.description;
+  if(!c.reason.empty()) std::cout << termcolor::bright_grey << " (" << c.reason << ")" << termcolor::reset;
+  std::cout << std::endl;
+}
+
+// up to k indices evenly spaced strictly between lo and hi, except skipped ones
+static Vector<size_t> pick_candidates(long lo, long hi, size_t k, const std::set<size_t> &skipped) {
+  Vector<size_t> open;
+  for(long i = lo + 1; i < hi; ++i) {
+    if(!skipped.count(i)) open.push_back(i);
+  }
+  if(open.size() <= k) return open;
+
+  Vector<size_t> ret;
+  for(size_t j = 1; j <= k; ++j) {
+    ret.push_back(open[j * open.size() / (k + 1)]);
+  }
+  ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+  return ret;
+}
+
+int bisect_run(const TestPath &paths, const String &range,
+  const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests,
+  const BisectOption &opt) {
+  std::ostringstream panic_msg;
+  const auto sep = range.find("..");
+  if(sep == String::npos || sep == 0 || sep + 2 >= range.size()) {
+    panic_msg << "The bisect range must be <good>..<bad>: " << range;
+    panic(panic_msg);
+  }
+  const auto good = range.substr(0, sep), bad = range.substr(sep + 2);
+
+  Vector<const TestCase*> tests;
+  for(const auto *v : {&target_tests, &persistence_tests}) {
+    for(const auto &t : *v) tests.push_back(&t);
+  }
+  if(tests.empty()) {
+    panic("No test to bisect with; select some with -- <test>.");
+  }
+
+  const auto commits = rev_list(paths.src, good, bad);
+  if(commits.empty()) {
+    panic_msg << "No revision between " << good << " and " << bad << ".";
+    panic(panic_msg);
+  }
+
+  const auto slots = std::max(1u, opt.slots);
+  const auto build_jobs = std::max(1u, HARDWARE_CONCURRENCY / slots);
+  std::cout << termcolor::bold << "Bisecting " << commits.size() << " revisions with " << tests.size()
+    << " tests, " << slots << " revisions at once" << termcolor::reset << std::endl;
+
+  std::mutex git_mut, print_mut;
+
+  // neither end is taken on trust: bad must fail and good must pass
+  std::cout << std::endl << termcolor::bold << "Endpoints" << termcolor::reset << std::endl;
+  const auto good_commit = resolve_rev(paths.src, good);
+  const auto bad_index = commits.size() - 1;
+  Candidate good_end, bad_end;
+  if(slots > 1) {
+    auto good_future = std::async(std::launch::async, test_revision, std::cref(paths), std::cref(good_commit),
+      0, 0, std::cref(tests), std::cref(opt), build_jobs, std::ref(git_mut));
+    bad_end = test_revision(paths, commits[bad_index], bad_index, 1, tests, opt, build_jobs, git_mut);
+    good_end = good_future.get();
+  } else {
+    good_end = test_revision(paths, good_commit, 0, 0, tests, opt, build_jobs, git_mut);
+    bad_end = test_revision(paths, commits[bad_index], bad_index, 0, tests, opt, build_jobs, git_mut);
+  }
+  print_candidate(good_end);
+  print_candidate(bad_end);
+  if(good_end.verdict != Verdict::good || bad_end.verdict != Verdict::bad) {
+    std::cout << std::endl << termcolor::red;
+    if(good_end.verdict == Verdict::skip || bad_end.verdict == Verdict::skip) {
+      std::cout << "Cannot bisect: an end of " << range << " cannot be tested.";
+    } else if(good_end.verdict == Verdict::bad) {
+      std::cout << "Cannot bisect: " << good << " fails the tests already.";
+    } else {
+      std::cout << "Cannot bisect: " << bad << " passes the tests.";
+    }
+    std::cout << termcolor::reset << std::endl;
+    return 1;
+  }
+
+  // commits[lo] is the last known good, commits[hi] the first known bad;
+  // -1 is good itself
+  long lo = -1, hi = static_cast<long>(commits.size()) - 1;
+  std::set<size_t> skipped;
+  unsigned round = 0;
+
+  while(true) {
+    const auto candidates = pick_candidates(lo, hi, slots, skipped);
+    if(candidates.empty()) break;
+
+    ++round;
+    std::cout << std::endl << termcolor::bold << "Round " << round << termcolor::reset
+      << ": " << (hi - lo - 1) << " revisions left, testing " << candidates.size() << std::endl;
+
+    Vector<std::future<Candidate>> futures;
+    for(size_t slot = 0; slot < candidates.size(); ++slot) {
+      const auto index = candidates[slot];
+      futures.push_back(std::async(std::launch::async, [&, slot, index]() {
+        const auto c = test_revision(paths, commits[index], index, slot, tests, opt, build_jobs, git_mut);
+        std::unique_lock lock{print_mut};
+        print_candidate(c);
+        return c;
+      }));
+    }
+
+    Vector<Candidate> results;
+    for(auto &f : futures) {
+      results.push_back(f.get());
+    }
+    // the lowest bad bounds the range; below it, the highest good
+    for(const auto &c : results) {
+      if(c.verdict == Verdict::bad) hi = std::min<long>(hi, c.index);
+    }
+    for(const auto &c : results) {
+      if(c.verdict == Verdict::good && static_cast<long>(c.index) < hi) lo = std::max<long>(lo, c.index);
+      if(c.verdict == Verdict::skip) skipped.insert(c.index);
+    }
+  }
+
+  std::cout << std::endl;
+  Vector<size_t> undecided;
+  for(long i = lo + 1; i < hi; ++i) undecided.push_back(i);
+  if(undecided.empty()) {
+    std::cout << termcolor::bold << "First bad revision: " << termcolor::red
+      << describe_commit(paths.src, commits[hi]) << termcolor::reset << std::endl;
+  } else {
+    std::cout << termcolor::bold << "The first bad revision is one of these; the others did not build:"
+      << termcolor::reset << std::endl;
+    for(const auto i : undecided) std::cout << "  " << describe_commit(paths.src, commits[i]) << std::endl;
+    std::cout << "  " << describe_commit(paths.src, commits[hi]) << std::endl;
+  }
+  std::cout << "Done in " << round << " rounds; worktrees are kept in "
+    << String{paths.build / "bisect.pincheck"} << std::endl;
+  return undecided.empty() ? 0 : 1;
+}
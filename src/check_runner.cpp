@@ -1,29 +1,130 @@
 #include <iostream>
+#include <fstream>
 
 #include "check_runner.h"
 #include "test_runner.h"
 #include "test_result.h"
-#include "console_helper.h"
+#include "soak_stats.h"
+#include "result_report.h"
+#include "efficiency_report.h"
+#include "test_scheduler.h"
+#include "status_renderer.h"
+#include "run_progress.h"
+#include "control_socket.h"
+#include "string_helper.h"
 #include "termcolor/termcolor.hpp"
 
+CheckOption::CheckOption()
+: is_verbose(false)
+, pool_size(1), repeats(1)
+, until_fail(false)
+, soak(), soak_dir()
+, report_json(), junit()
+, trace(nullptr)
+, baseline(BaselineMode::none), baseline_file()
+, baseline_fail(false)
+, history(nullptr)
+, kernel_stats(nullptr)
+, profile(nullptr)
+, remote(nullptr)
+, metrics(nullptr) {}
+
+bool CheckOption::is_soak() const {
+  return until_fail || soak.has_value();
+}
+
+static void trace_test(TraceLog &trace, size_t slot, const TestResult &r) {
+  using namespace std::chrono;
+  const auto tid = static_cast<unsigned>(slot) + 1;
+  const auto name = r.testcase.persistence ? r.testcase.name + "(-persistence)" : r.testcase.name;
+  const auto category = r.testcase.persistence ? "persistence" : "test";
+  const auto run_end = r.start_time + duration_cast<system_clock::duration>(duration<double>(r.run_sec));
+  const auto check_end = run_end + duration_cast<system_clock::duration>(duration<double>(r.check_sec));
+
+  trace.span(name, category, tid, r.start_time, r.end_time,
+    "{\"subdir\":\"" + json_escape(r.testcase.subdir) + "\",\"status\":\"" + r.status() + "\"}");
+  trace.span("run", "phase", tid, r.start_time, run_end);
+  trace.span("check", "phase", tid, run_end, check_end);
+}
+
 int check_run(const TestPath &paths, const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests,
-  bool is_verbose, unsigned pool_size, unsigned repeats) {
+  const CheckOption &opt) {
   using namespace std::string_literals;
 
+  const auto is_verbose = opt.is_verbose;
+  // persistence pairs only run here, and so does the rest once every
+  // worker is lost
+  const size_t local_size = std::max(opt.pool_size, opt.remote ? 1u : 0u);
+  const auto pool_size = local_size + (opt.remote ? opt.remote->size() : 0);
+  const auto repeats = opt.repeats;
   const auto full_test_size = target_tests.size() + 2 * persistence_tests.size();
 
-  const String omit_msg = " ... ";
-  constexpr auto COL_JITTER = 3;
+  unsigned epoch_passed = 0, epoch_done = 0;
+
+  Optional<SoakStats> soak;
+  if(opt.is_soak()) {
+    soak.emplace(opt.soak_dir);
+  }
+  Optional<JsonReport> json_report;
+  Optional<JunitReport> junit_report;
+  if(opt.report_json) json_report.emplace(*opt.report_json);
+  if(opt.junit) junit_report.emplace(*opt.junit);
+
+  Optional<Baseline> baseline;
+  Baseline current;
+  if(opt.baseline == BaselineMode::compare) {
+    baseline = Baseline::load(opt.baseline_file);
+  }
+
+  ControlSocket control{control_socket(paths.build)};
+  if(is_verbose && control.is_open()) {
+    std::cout << "Control socket: " << String{control_socket(paths.build)} << std::endl;
+  }
+  // steered through the control socket
+  size_t active_local = local_size;
+  bool stopping = false;
+
+  // a full name, or the name of exactly one test
+  const auto resolve = [&](const String &test) -> Optional<String> {
+    Optional<String> found;
+    for(const auto *tests : {&target_tests, &persistence_tests}) {
+      for(const auto &t : *tests) {
+        if(t.full_name() == test) return test;
+        if(t.name != test) continue;
+        if(found) return std::nullopt;
+        found = t.full_name();
+      }
+    }
+    return found;
+  };
+
+  StatusRenderer renderer;
 
-  unsigned epoch_passed = 0;
+  auto has_next_epoch = [&](unsigned epoch) {
+    if(stopping) return false;
+    if(opt.until_fail && epoch_done != epoch_passed) return false;
+    // 0 is no limit only when soaking; otherwise it runs nothing, as before
+    if((repeats != 0 || !opt.is_soak()) && epoch > repeats) return false;
+    return !opt.soak || soak->elapsed() < *opt.soak;
+  };
 
-  for(unsigned epoch = 1; epoch <= repeats; ++epoch){
-  Vector<TestResult> results, results_cache;
+  for(unsigned epoch = 1; has_next_epoch(epoch); ++epoch){
+  // only failed results are kept until the end of epoch
+  Vector<TestResult> failed_results, results_cache;
+  Vector<Pair<String, KernelGrowth>> kernel_changes;
   Vector<std::unique_ptr<TestRunner>> pool(pool_size);
 
-  size_t next = 0, next_pers = 0;
+  TestQueue queue(target_tests, persistence_tests);
+  size_t finished = 0;
+  unsigned passed = 0;
 
-  if(repeats > 1) {
+  if(soak) {
+    std::cout << termcolor::bold << "\nSoak epoch " << epoch << termcolor::reset;
+    if(opt.soak) {
+      std::cout << " (" << format_duration(soak->elapsed()) << " of " << format_duration(*opt.soak) << ")";
+    }
+    std::cout << std::endl;
+  } else if(repeats > 1) {
     std::cout << termcolor::bold << "\nEpoch " << epoch << " of " << repeats << termcolor::reset;
     std::cout << " (so far: " << termcolor::green << epoch_passed << " epochs passed, "
       << termcolor::red << (epoch - epoch_passed - 1) << " epochs failed" << termcolor::reset << ")" << std::endl;
@@ -31,12 +132,104 @@ int check_run(const TestPath &paths, const Vector<TestCase> &target_tests, const
   
   // init pool print
   std::cout << std::endl;
-  while(results.size() < full_test_size) {
+  Optional<TraceScope> epoch_span;
+  epoch_span.emplace(opt.trace, "epoch " + std::to_string(epoch));
+  RunProgress progress(target_tests, persistence_tests, opt.history, pool_size);
+  renderer.set_progress(&progress);
+  EfficiencyReport efficiency(pool_size);
+  auto &rows = renderer.row_stream();
+  const auto answer = [&](const ControlRequest &req) {
+    const auto tokens = string_tokenize(req.line);
+    const auto verb = tokens.empty() ? String{} : tokens[0];
+    std::ostringstream os;
+    if(verb == "list" && tokens.size() == 1) {
+      for(size_t i = 0; i < pool_size; ++i) {
+        if(!pool[i]) continue;
+        const auto &t = pool[i]->get_test_case();
+        os << "running " << i + 1 << ' ' << t.full_name() << (t.persistence ? "(-persistence)" : "")
+          << ' ' << format_fixed(pool[i]->get_elapsed_sec(), 1) << (i >= local_size ? " remote" : "") << '\n';
+      }
+      size_t n = 0;
+      for(const auto *t : queue.pending()) {
+        os << "queued " << ++n << ' ' << t->full_name() << '\n';
+      }
+      control.reply(req, os.str());
+    } else if((verb == "cancel" || verb == "bump") && tokens.size() == 2) {
+      const auto full_name = resolve(tokens[1]);
+      if(!full_name) {
+        control.reply(req, "", "no single test is " + tokens[1]);
+      } else if(verb == "bump") {
+        if(queue.bump(*full_name)) {
+          control.reply(req, *full_name + " runs next");
+        } else {
+          control.reply(req, "", *full_name + " is not queued");
+        }
+      } else {
+        const auto it = std::find_if(pool.begin(), pool.end(), [&](const std::unique_ptr<TestRunner> &p) {
+          return p && p->get_test_case().full_name() == *full_name;
+        });
+        if(it == pool.end()) {
+          control.reply(req, "", *full_name + " is not running");
+        } else {
+          (*it)->cancel();
+          control.reply(req, *full_name + " cancelled");
+        }
+      }
+    } else if(verb == "slots" && tokens.size() == 2) {
+      unsigned long n = 0;
+      try {
+        n = std::stoul(tokens[1]);
+      } catch(std::exception&) {}
+      if(n < 1 || n > local_size) {
+        control.reply(req, "", "slots must be 1 to " + std::to_string(local_size) + ", as given by -j");
+      } else {
+        active_local = n;
+        control.reply(req, "using " + std::to_string(n) + " of " + std::to_string(local_size) + " local slots");
+      }
+    } else if(verb == "summary" && tokens.size() == 1) {
+      const auto running = std::count_if(pool.cbegin(), pool.cend(), [](const std::unique_ptr<TestRunner> &p){return p != nullptr;});
+      os << "epoch " << epoch << ": finished " << finished << " of " << full_test_size
+        << ", passed " << passed << ", failed " << finished - passed
+        << ", running " << running << ", queued " << queue.pending().size() << '\n';
+      for(const auto &r : failed_results) {
+        const auto reason = r.reason();
+        os << "failed " << r.testcase.full_name() << ' ' << reason.substr(0, reason.find('\n')) << '\n';
+      }
+      control.reply(req, os.str());
+    } else if(verb == "stop" && tokens.size() == 1) {
+      stopping = true;
+      control.reply(req, "no more tests are dispatched; the run ends when the running ones finish");
+    } else {
+      control.reply(req, "", "unknown command '" + req.line + "'; expected list, cancel <test>, bump <test>, slots <n>, summary or stop");
+    }
+  };
+
+  Optional<ProfileScope> loop_profile, step_profile;
+  loop_profile.emplace(opt.profile, "dispatch loop");
+  while(finished < full_test_size) {
+    step_profile.emplace(opt.profile, "collect results");
     for(size_t i = 0; i < pool_size; ++i) {
       if(pool[i]) {
         if(pool[i]->is_finished()) {
+          progress.finish(pool[i]->get_test_case());
           auto v = pool[i]->get_results();
+          if(opt.metrics) opt.metrics->finished(i, v);
+          if(!v.empty()) {
+            efficiency.record(i, v.front());
+            if(opt.history) opt.history->record(v.front());
+            if(opt.trace) trace_test(*opt.trace, i, v.front());
+          }
           for(auto& u : v) {
+            if(opt.kernel_stats) {
+              const auto name = u.testcase.full_name();
+              if(const auto prev = opt.kernel_stats->find(name)) {
+                u.kernel_prev = *prev;
+                for(auto &g : kernel_growth(*prev, u.kernel)) {
+                  kernel_changes.emplace_back(name, std::move(g));
+                }
+              }
+              opt.kernel_stats->record(name, u.kernel);
+            }
             results_cache.emplace_back(std::move(u));
           }
           pool[i] = nullptr;
@@ -44,85 +237,111 @@ int check_run(const TestPath &paths, const Vector<TestCase> &target_tests, const
       }
     }
 
+    step_profile.emplace(opt.profile, "dispatch");
     // check persistence test is executing
-    bool can_execute_persistence = next_pers < persistence_tests.size();
-    if(can_execute_persistence) {
-      for(size_t i = 0; i < pool_size; ++i) {
-        if(pool[i]) {
-          if(pool[i]->get_test_case().persistence) {
-            can_execute_persistence = false;
-            break;
-          }
-        }
-      }
-    }
+    bool persistence_running = std::any_of(pool.cbegin(), pool.cend(),
+      [](const std::unique_ptr<TestRunner>& p){return p && p->get_test_case().persistence;});
 
-    for(size_t i = 0; i < pool_size; ++i) {
+    for(size_t i = 0; i < pool_size && !queue.empty() && !stopping; ++i) {
       if(pool[i]) continue;
-      if(can_execute_persistence) {
-        pool[i] = std::make_unique<TestRunner>(persistence_tests[next_pers]);
-        pool[i]->register_test(paths);
-        ++next_pers;
-        can_execute_persistence = false;
-      } else if(next < target_tests.size()){
-        pool[i] = std::make_unique<TestRunner>(target_tests[next]);
-        pool[i]->register_test(paths);
-        ++next;
-      }
+      const bool is_remote = i >= local_size;
+      if(!is_remote && i >= active_local) continue;
+      // a lost worker is retired, not replaced by local runs beyond -j
+      if(is_remote && opt.remote->slot(i - local_size)->is_lost()) continue;
+      const auto testcase = queue.pop(persistence_running || is_remote);
+      if(!testcase) break;
+      pool[i] = std::make_unique<TestRunner>(*testcase);
+      if(opt.metrics) opt.metrics->dispatched(i);
+      pool[i]->register_test(paths, is_verbose, is_remote ? opt.remote->slot(i - local_size) : nullptr);
+      persistence_running = persistence_running || testcase->persistence;
     }
 
+    step_profile.emplace(opt.profile, "report results");
     if(!results_cache.empty()) {
-      std::cout << "\033[2K\033[1G";
-      for(const auto& r : results_cache) {
-        r.print_row(true, is_verbose);
-        std::cout << std::endl;
-        results.emplace_back(r);
+      for(auto& r : results_cache) {
+        ++finished;
+        if(json_report) json_report->write(r, epoch);
+        if(opt.baseline != BaselineMode::none) current.add(r);
+        if(junit_report) junit_report->add(r);
+        if(soak) {
+          // passing rows are folded into the counters; failing ones are spilled
+          if(const auto spilled = soak->record(r, epoch); !r.passed) {
+            r.print_row(rows, false, is_verbose);
+            if(spilled) rows << termcolor::bright_grey << " -> " << String{*spilled} << termcolor::reset;
+            rows << '\n';
+          }
+        } else {
+          r.print_row(rows, true, is_verbose);
+          rows << '\n';
+        }
+        if(r.passed) {
+          ++passed;
+        } else if(!soak) {
+          failed_results.emplace_back(std::move(r));
+        }
       }
       results_cache.clear();
     }
+    if(stopping && std::none_of(pool.cbegin(), pool.cend(), [](const std::unique_ptr<TestRunner> &p){return p != nullptr;})) {
+      break;
+    }
 
-    const auto running_pools = std::count_if(pool.cbegin(), pool.cend(),
-      [](const std::unique_ptr<TestRunner>& p){return p!=nullptr;});
-    const String full_pool_msg = "Running"s + "(" + std::to_string(running_pools) + "/" + std::to_string(pool_size) + ") : ";
-    std::cout << "\033[2K\033[1G";
-    std::cout << termcolor::reset << termcolor::bold << termcolor::yellow
-      << full_pool_msg;
-    std::cout << termcolor::reset << termcolor::yellow;
-    std::string pool_str;
-    for(auto& p : pool) {
-      if(!p) continue;
-      if(p->get_test_case().persistence) {
-        pool_str += "\033[35m"s + p->get_print() + "\033[33m ";
-      } else {
-        pool_str += p->get_print() + " ";
-      }
-      if (const size_t ws_col = get_winsize().ws_col;
-        pool_str.size() + full_pool_msg.size() + COL_JITTER >= ws_col) {
-        pool_str = pool_str.substr(0, ws_col - full_pool_msg.size() - COL_JITTER - omit_msg.size());
-        pool_str += omit_msg;
-        break;
-      }
+    if(opt.metrics) {
+      const auto running = std::count_if(pool.cbegin(), pool.cend(), [](const std::unique_ptr<TestRunner> &p){return p != nullptr;});
+      opt.metrics->pool(active_local + (pool_size - local_size), running, queue.size());
+      opt.metrics->flush();
+    }
+
+    step_profile.emplace(opt.profile, "render");
+    renderer.render(pool);
+    step_profile.reset();
+    for(const auto &req : control.wait(CHECK_POLL_INTERVAL)) {
+      answer(req);
     }
-    std::cout << pool_str << termcolor::reset << std::flush;
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
   }
 
-  unsigned passed = std::count_if(results.begin(), results.end(),
-    [](const TestResult& r){return r.passed;});
-  unsigned failed = full_test_size - passed;
+  loop_profile.reset();
+  renderer.clear();
+  efficiency.finish();
+  if(opt.metrics) opt.metrics->flush(true);
+  if(opt.history) opt.history->save();
+  if(opt.kernel_stats) opt.kernel_stats->save();
+  epoch_span.reset();
+  TraceScope summary_span(opt.trace, "summary");
+  ProfileScope summary_profile(opt.profile, "summary");
+  if(junit_report) {
+    junit_report->end_epoch(paths.project + " (epoch " + std::to_string(epoch) + ")");
+  }
 
-  std::cout << "\033[2K\033[1G";
-  std::cout << "\nFinished total " << termcolor::bold << full_test_size << " tests." << termcolor::reset << std::endl;
-  
+  const unsigned not_run = full_test_size - finished;
+  unsigned failed = finished - passed;
   const bool all_passed = (passed == full_test_size);
+  ++epoch_done;
+  if (all_passed) {
+    epoch_passed++;
+  }
+
+  if (soak) {
+    soak->end_epoch(all_passed);
+    soak->print_summary(std::cout, false);
+    std::ofstream summary_fs(opt.soak_dir / "summary.txt");
+    if (summary_fs.is_open()) {
+      soak->print_summary(summary_fs, true);
+    }
+    continue;
+  }
+
+  if(not_run > 0) {
+    std::cout << "\nStopped after " << termcolor::bold << finished << " of " << full_test_size << " tests." << termcolor::reset << std::endl;
+  } else {
+    std::cout << "\nFinished total " << termcolor::bold << full_test_size << " tests." << termcolor::reset << std::endl;
+  }
 
   if (!all_passed) {
     std::cout << "\n" << termcolor::bright_red << "-- Failed tests --" << termcolor::reset << std::endl;
-    for (const auto& tr : results) {
-      if(!tr.passed) {
-        tr.print_row(is_verbose, is_verbose);
-        std::cout << std::endl;
-      }
+    for (const auto& tr : failed_results) {
+      tr.print_row(std::cout, is_verbose, is_verbose);
+      std::cout << std::endl;
     }
     std::cout << std::endl;
   }
@@ -133,21 +352,60 @@ int check_run(const TestPath &paths, const Vector<TestCase> &target_tests, const
   std::cout << termcolor::reset << termcolor::red << "Fail: ";
   if(failed != 0) std::cout << termcolor::bold;
   std::cout << failed;
+  if(not_run > 0) {
+    std::cout << termcolor::reset << termcolor::yellow << "\tNot run: " << termcolor::bold << not_run;
+  }
   std::cout << termcolor::reset << std::endl << std::endl;
 
+  if(!kernel_changes.empty()) {
+    std::cout << termcolor::yellow << "-- Kernel statistics grown since the last run --" << termcolor::reset << std::endl;
+    for(const auto &[name, g] : kernel_changes) {
+      std::cout << name << ": " << g.counter << " " << g.before << " -> " << termcolor::bold << g.after << termcolor::reset;
+      if(g.before > 0) {
+        std::cout << " (+" << format_fixed(100.0 * (g.after - g.before) / g.before, 0) << "%)";
+      }
+      std::cout << std::endl;
+    }
+    std::cout << std::endl;
+  }
+
+  efficiency.print(std::cout);
+  std::cout << std::endl;
+
   if (all_passed) {
     std::cout << termcolor::blue << termcolor::bold << "Correct!" << termcolor::reset << std::endl;
-    epoch_passed++;
   }
 
   } // for-loop of epoch
 
-  bool all_epoch_passed = epoch_passed == repeats;
+  bool all_epoch_passed = epoch_passed == epoch_done;
   int return_value = all_epoch_passed ? 0 : 1;
-  if (repeats > 1) {
-    unsigned epoch_failed = repeats - epoch_passed;
+
+  if(opt.baseline == BaselineMode::save) {
+    std::cout << std::endl;
+    if(all_epoch_passed) {
+      current.save(opt.baseline_file);
+      std::cout << "Baseline of " << current.size() << " tests saved to " << String{opt.baseline_file} << std::endl;
+    } else {
+      std::cout << termcolor::yellow << "Baseline not saved; it must come from a passing run." << termcolor::reset << std::endl;
+    }
+  } else if(baseline) {
+    const auto regressions = baseline->compare(current);
+    std::cout << std::endl;
+    print_regressions(std::cout, regressions, baseline->overlap(current));
+    if(opt.baseline_fail && !regressions.empty()) {
+      return_value = 1;
+    }
+  }
+  if (soak) {
+    std::cout << std::endl;
+    std::cout << termcolor::bold << "Soak finished after " << epoch_done << " epochs." << termcolor::reset << std::endl;
+    soak->print_summary(std::cout, true);
+    std::cout << "Failing outputs are kept in " << String{opt.soak_dir} << std::endl;
+  } else if (epoch_done > 1) {
+    unsigned epoch_failed = epoch_done - epoch_passed;
     std::cout << std::endl;
-    std::cout << termcolor::bold << "All " << repeats << " trials done." << std::endl;
+    std::cout << termcolor::bold << "All " << epoch_done << " trials done." << std::endl;
     std::cout << termcolor::reset << termcolor::green << "All passing epochs: ";
     if(epoch_passed != 0) std::cout << termcolor::bold;
     std::cout << epoch_passed << std::endl;
@@ -163,4 +421,4 @@ int check_run(const TestPath &paths, const Vector<TestCase> &target_tests, const
   }
 
   return return_value;
-}
\ No newline at end of file
+}
@@ -1,7 +1,7 @@
 #include "console_helper.h"
 
-struct winsize get_winsize() {
-  struct winsize winsize;
-  ioctl(0, TIOCGWINSZ, &winsize);
+struct winsize get_winsize(int fd) {
+  struct winsize winsize{};
+  ioctl(fd, TIOCGWINSZ, &winsize);
   return winsize;
 }
\ No newline at end of file
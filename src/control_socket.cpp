@@ -0,0 +1,151 @@
+#include <iostream>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "control_socket.h"
+#include "socket_helper.h"
+#include "test_path.h"
+
+// a command longer than this is a broken client
+constexpr size_t MAX_COMMAND = 1 << 12;
+// and an answer line longer than this a broken session
+constexpr size_t MAX_ANSWER_LINE = 1 << 16;
+constexpr int CONTROL_SEND_TIMEOUT_MS = 1000;
+
+Path control_socket(const Path &build) {
+  return build / "pincheck-control.sock";
+}
+
+ControlSocket::ControlSocket(Path file)
+: listen_fd(-1), file(std::move(file)), clients() {
+  sockaddr_un addr;
+  if(!fill_address(this->file, addr)) return;
+  if(const int fd = connect_socket(this->file); fd >= 0) {
+    close(fd);
+    return;
+  }
+  // left by a session that did not end cleanly
+  std::error_code ec;
+  fs::remove(this->file, ec);
+
+  listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if(listen_fd < 0) return;
+  if(bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd, 4) != 0) {
+    close(listen_fd);
+    listen_fd = -1;
+  }
+}
+
+ControlSocket::~ControlSocket() noexcept {
+  for(const auto &c : clients) {
+    close(c.fd);
+  }
+  if(listen_fd >= 0) {
+    close(listen_fd);
+    std::error_code ec;
+    fs::remove(file, ec);
+  }
+}
+
+bool ControlSocket::is_open() const {
+  return listen_fd >= 0;
+}
+
+Vector<ControlRequest> ControlSocket::wait(std::chrono::milliseconds timeout) {
+  Vector<pollfd> fds;
+  if(listen_fd >= 0) fds.push_back(pollfd{listen_fd, POLLIN, 0});
+  for(const auto &c : clients) {
+    fds.push_back(pollfd{c.fd, POLLIN, 0});
+  }
+  Vector<ControlRequest> ret;
+  if(poll(fds.data(), fds.size(), static_cast<int>(timeout.count())) <= 0) return ret;
+
+  if(listen_fd >= 0 && (fds[0].revents & POLLIN)) {
+    int fd;
+    while((fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK)) >= 0) {
+      clients.push_back(Client{fd, String{}});
+    }
+  }
+
+  for(auto it = clients.begin(); it != clients.end(); ) {
+    bool closed = false;
+    Buffer chunk;
+    ssize_t r;
+    while((r = recv(it->fd, chunk.data(), chunk.size(), 0)) > 0) {
+      it->buffer.append(chunk.data(), r);
+    }
+    if(r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) closed = true;
+
+    size_t nl;
+    while((nl = it->buffer.find('\n')) != String::npos) {
+      auto line = it->buffer.substr(0, nl);
+      it->buffer.erase(0, nl + 1);
+      if(!line.empty() && line.back() == '\r') line.pop_back();
+      ret.push_back(ControlRequest{it->fd, std::move(line)});
+    }
+    if(it->buffer.size() > MAX_COMMAND) closed = true;
+
+    // a client that sent its commands and shut down still gets its answers
+    if(closed && std::none_of(ret.cbegin(), ret.cend(), [&it](const ControlRequest &q){return q.fd == it->fd;})) {
+      close(it->fd);
+      it = clients.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return ret;
+}
+
+void ControlSocket::reply(const ControlRequest &req, const String &text, const Optional<String> &error) {
+  String bytes = text;
+  if(!bytes.empty() && bytes.back() != '\n') bytes += '\n';
+  bytes += error ? "ERR " + *error + "\n" : "OK\n";
+
+  size_t done = 0;
+  while(done < bytes.size()) {
+    const auto r = send(req.fd, bytes.data() + done, bytes.size() - done, MSG_NOSIGNAL);
+    if(r > 0) {
+      done += r;
+      continue;
+    }
+    if(r < 0 && errno == EINTR) continue;
+    // a client that does not read is dropped rather than stalling the run
+    pollfd pfd{req.fd, POLLOUT, 0};
+    if(r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) || poll(&pfd, 1, CONTROL_SEND_TIMEOUT_MS) <= 0) {
+      shutdown(req.fd, SHUT_RDWR);
+      return;
+    }
+  }
+}
+
+int control_client(const Path &cwd, const String &project, const String &command) {
+  int fd = -1;
+  for(const auto &dir : guess_builds(cwd, project)) {
+    if((fd = connect_socket(control_socket(dir))) >= 0) break;
+  }
+  if(fd < 0) {
+    std::cerr << "No check session of this project is running here." << std::endl;
+    return 1;
+  }
+
+  send_all(fd, command + "\n");
+  shutdown(fd, SHUT_WR);
+
+  String buffer;
+  int exit_code = 1;
+  while(const auto line = read_line(fd, buffer, MAX_ANSWER_LINE)) {
+    if(*line == "OK") {
+      exit_code = 0;
+      break;
+    }
+    if(line->rfind("ERR ", 0) == 0) {
+      std::cerr << line->substr(4) << std::endl;
+      break;
+    }
+    std::cout << *line << std::endl;
+  }
+  close(fd);
+  return exit_code;
+}
@@ -0,0 +1,423 @@
+#include <iostream>
+#include <cstring>
+#include <csignal>
+#include <cstdio>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "daemon_server.h"
+#include "socket_helper.h"
+#include "execution.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+// a request longer than this is a broken client
+constexpr size_t MAX_REQUEST = 1 << 16;
+constexpr int DAEMON_POLL_MS = 100;
+
+Path daemon_socket(const Path &build) {
+  return build / "pincheck.sock";
+}
+
+Optional<Path> find_daemon_socket(const Path &cwd, const String &project) {
+  for(const auto &dir : guess_builds(cwd, project)) {
+    std::error_code ec;
+    if(fs::is_socket(daemon_socket(dir), ec)) return daemon_socket(dir);
+  }
+  return std::nullopt;
+}
+
+// the version and the binary of pincheck; a daemon serves only clients of
+// the same binary, whose arguments it parses the same way
+static String daemon_identity(const String &version) {
+  std::error_code ec;
+  const auto exe = fs::read_symlink("/proc/self/exe", ec);
+  const auto time = ec ? fs::file_time_type{} : fs::last_write_time(exe, ec);
+  return version + "/" + std::to_string(time.time_since_epoch().count());
+}
+
+/** Daemon */
+
+namespace {
+  struct Request {
+    String identity, project;
+    Path cwd;
+    Vector<String> args;
+    std::array<int, 3> fds{-1, -1, -1};
+    String buffer; // what the client sent after the request
+
+    Request() = default;
+    Request(const Request&) = delete;
+    Request& operator=(const Request&) = delete;
+    ~Request() noexcept {
+      for(const auto fd : fds) {
+        if(fd >= 0) close(fd);
+      }
+    }
+  };
+}
+
+// the request line carries the stdio of the client
+static bool read_request(int fd, Request &req) {
+  Buffer chunk;
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * 3)];
+  iovec iov{chunk.data(), chunk.size()};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t r;
+  do {
+    r = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+  } while(r < 0 && errno == EINTR);
+  if(r <= 0) return false;
+  for(auto *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+    if(c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+    const auto n = std::min<size_t>(3, (c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+    std::memcpy(req.fds.data(), CMSG_DATA(c), n * sizeof(int));
+  }
+  req.buffer.assign(chunk.data(), r);
+
+  const auto header = read_line(fd, req.buffer, MAX_REQUEST);
+  if(!header) return false;
+  const auto tokens = string_tokenize(*header);
+  if(tokens.size() != 4 || tokens[0] != "RUN") return false;
+  req.identity = tokens[1];
+  req.project = tokens[2] == "-" ? "" : tokens[2];
+  size_t argc;
+  try {
+    argc = std::stoul(tokens[3]);
+  } catch(std::exception&) {
+    return false;
+  }
+
+  const auto cwd = read_line(fd, req.buffer, MAX_REQUEST);
+  if(!cwd) return false;
+  req.cwd = *cwd;
+  for(size_t i = 0; i < argc; ++i) {
+    auto arg = read_line(fd, req.buffer, MAX_REQUEST);
+    if(!arg) return false;
+    req.args.push_back(std::move(*arg));
+  }
+  return std::all_of(req.fds.cbegin(), req.fds.cend(), [](int f){return f >= 0;});
+}
+
+// sizes and mtimes of the sources, skipping build directories
+static String tree_fingerprint(const Path &src) {
+  std::error_code ec;
+  size_t files = 0;
+  std::uintmax_t bytes = 0;
+  fs::file_time_type latest{};
+  for(auto it = fs::recursive_directory_iterator(src, fs::directory_options::skip_permission_denied, ec);
+      !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    const auto name = it->path().filename().string();
+    if(it->is_directory(ec)) {
+      if(name == "build" || (!name.empty() && name[0] == '.')) it.disable_recursion_pending();
+      continue;
+    }
+    if(name == "pincheck.sock") continue;
+    ++files;
+    bytes += it->file_size(ec);
+    latest = std::max(latest, it->last_write_time(ec));
+  }
+  return std::to_string(files) + "/" + std::to_string(bytes) + "/" + std::to_string(latest.time_since_epoch().count());
+}
+
+static fs::file_time_type file_time(const Path &file) {
+  std::error_code ec;
+  const auto time = fs::last_write_time(file, ec);
+  return ec ? fs::file_time_type{} : time;
+}
+
+// brings the state up to the sources and the files the children saved;
+// false if the build or the listing of its tests fails, after printing why
+static bool refresh(DaemonState &state) {
+  auto &paths = state.paths;
+  const auto fingerprint = tree_fingerprint(paths.src);
+  if(fingerprint != state.fingerprint || !fs::exists(paths.build / "kernel.bin")) {
+    if(!state.fingerprint.empty()) {
+      std::cout << "Sources changed; building " << paths.project << "..." << std::endl;
+    }
+    String output;
+    if(!make_build(paths, HARDWARE_CONCURRENCY, output)) {
+      std::cerr << termcolor::red << output << termcolor::reset << std::endl;
+      state.fingerprint.clear();
+      return false;
+    }
+    try {
+      // a tree whose tests cannot be listed fails this request, not the daemon
+      PanicScope panic_scope;
+      state.catalog = discover_tests(paths, TestFilter{}, nullptr);
+    } catch(const PanicError &e) {
+      std::cerr << termcolor::red << e.what() << termcolor::reset << std::endl;
+      state.fingerprint.clear();
+      return false;
+    }
+    // taken before the build, so edits made during it build again
+    state.fingerprint = fingerprint;
+  }
+
+  const auto history_file = paths.build / "history.pincheck";
+  if(!state.history || file_time(history_file) != state.history_time) {
+    state.history_time = file_time(history_file);
+    state.history.emplace(history_file);
+  }
+  const auto kernel_stats_file = paths.build / "kernel_stats.pincheck";
+  if(!state.kernel_stats || file_time(kernel_stats_file) != state.kernel_stats_time) {
+    state.kernel_stats_time = file_time(kernel_stats_file);
+    state.kernel_stats.emplace(kernel_stats_file);
+  }
+  return true;
+}
+
+static pid_t daemon_pid = 0;
+static char socket_path[sizeof(sockaddr_un::sun_path)];
+
+static void remove_socket() {
+  if(getpid() == daemon_pid) unlink(socket_path);
+}
+
+static void stop_daemon(int sig) {
+  unlink(socket_path);
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+// points stdin, stdout and stderr to the given fds, returning the old ones
+static std::array<int, 3> redirect_stdio(const std::array<int, 3> &fds) {
+  std::cout.flush();
+  std::cerr.flush();
+  std::fflush(nullptr);
+  std::array<int, 3> saved;
+  for(int i = 0; i < 3; ++i) {
+    saved[i] = fcntl(i, F_DUPFD_CLOEXEC, 3);
+    dup2(fds[i], i);
+  }
+  return saved;
+}
+
+static void restore_stdio(std::array<int, 3> &saved) {
+  std::cout.flush();
+  std::cerr.flush();
+  std::fflush(nullptr);
+  for(int i = 0; i < 3; ++i) {
+    dup2(saved[i], i);
+    close(saved[i]);
+  }
+}
+
+static int serve_request(int listen_fd, int fd, Request &req, DaemonState &state, DaemonRun run) {
+  auto saved = redirect_stdio(req.fds);
+  if(!refresh(state)) {
+    restore_stdio(saved);
+    return 1;
+  }
+
+  const pid_t pid = fork();
+  if(pid == 0) {
+    close(listen_fd);
+    close(fd);
+    // its own group, to be interrupted with the processes it spawns
+    setpgid(0, 0);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+    const auto exit_code = run(state, req.args, req.cwd);
+    std::exit(exit_code);
+  }
+  restore_stdio(saved);
+  if(pid < 0) {
+    std::cerr << "Cannot fork for the request: " << std::strerror(errno) << std::endl;
+    return 1;
+  }
+  setpgid(pid, pid);
+
+  // forwards interrupts of the client until the child exits
+  unsigned interrupts = 0;
+  bool client_gone = false;
+  while(true) {
+    int status;
+    const auto r = waitpid(pid, &status, WNOHANG);
+    if(r == pid) {
+      return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    if(r < 0 && errno != EINTR) return 1;
+
+    pollfd pfd{fd, POLLIN, 0};
+    if(client_gone || poll(&pfd, 1, DAEMON_POLL_MS) <= 0) {
+      if(client_gone) usleep(DAEMON_POLL_MS * 1000);
+      continue;
+    }
+    const auto line = read_line(fd, req.buffer, MAX_REQUEST);
+    if(!line) client_gone = true;
+    if(!line || *line == "INT") {
+      kill(-pid, interrupts++ == 0 ? SIGINT : SIGKILL);
+    }
+  }
+}
+
+int daemon_serve(const TestPath &paths, const String &version, DaemonRun run) {
+  std::ostringstream panic_msg;
+  const auto socket = daemon_socket(paths.build);
+  sockaddr_un addr;
+  if(!fill_address(socket, addr)) {
+    panic_msg << "The path of the daemon socket is too long: " << socket;
+    panic(panic_msg);
+  }
+  if(fs::exists(socket)) {
+    if(const int fd = connect_socket(socket); fd >= 0) {
+      close(fd);
+      panic_msg << "A daemon already serves " << paths.project << " at " << socket;
+      panic(panic_msg);
+    }
+    fs::remove(socket);
+  }
+
+  DaemonState state;
+  state.paths = paths;
+  std::cout << "Extracting list of tests. May take some times..." << std::endl;
+  if(!refresh(state)) return 1;
+
+  const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+    || listen(listen_fd, 8) != 0) {
+    panic_msg << "Cannot listen on " << socket << ": " << std::strerror(errno);
+    panic(panic_msg);
+  }
+  daemon_pid = getpid();
+  std::memcpy(socket_path, addr.sun_path, sizeof(socket_path));
+  std::atexit(remove_socket);
+  signal(SIGINT, stop_daemon);
+  signal(SIGTERM, stop_daemon);
+  signal(SIGHUP, stop_daemon);
+  // a client gone while its output is written
+  signal(SIGPIPE, SIG_IGN);
+
+  const auto identity = daemon_identity(version);
+  std::cout << termcolor::bold << "Serving " << paths.project << " ("
+    << state.catalog.target_tests.size() + 2 * state.catalog.persistence_tests.size()
+    << " tests) at " << String{socket} << termcolor::reset << std::endl;
+  std::cout << "Run pincheck as usual in " << String{paths.src / paths.project}
+    << " or its build directory; Ctrl-C stops the daemon." << std::endl;
+
+  while(true) {
+    const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if(fd < 0) {
+      if(errno == EINTR || errno == ECONNABORTED) continue;
+      panic_msg << "Cannot accept on " << socket << ": " << std::strerror(errno);
+      panic(panic_msg);
+    }
+
+    Request req;
+    if(read_request(fd, req)) {
+      if(req.identity != identity) {
+        send_all(fd, "NO the daemon runs another pincheck\n");
+      } else if(!req.project.empty() && req.project != paths.project) {
+        send_all(fd, "NO the daemon serves " + paths.project + "\n");
+      } else if(send_all(fd, "OK\n")) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto exit_code = serve_request(listen_fd, fd, req, state, run);
+        send_all(fd, "EXIT " + std::to_string(exit_code) + "\n");
+
+        const auto sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << termcolor::grey << "[" << format_fixed(sec, 1) << " sec, exit " << exit_code << "]"
+          << termcolor::reset;
+        for(size_t i = 1; i < req.args.size(); ++i) {
+          std::cout << ' ' << req.args[i];
+        }
+        std::cout << std::endl;
+      }
+    }
+    close(fd);
+  }
+}
+
+/** Client */
+
+static volatile std::sig_atomic_t client_interrupted = 0;
+
+static void interrupt_client(int) {
+  client_interrupted = 1;
+}
+
+Optional<int> daemon_client(const Path &socket, const String &version, const String &project,
+  const Vector<String> &args, const Path &cwd) {
+  const auto has_newline = [](const String &s){return s.find('\n') != String::npos;};
+  if(has_newline(cwd) || std::any_of(args.cbegin(), args.cend(), has_newline)) return std::nullopt;
+
+  const int fd = connect_socket(socket);
+  if(fd < 0) return std::nullopt;
+
+  std::ostringstream os;
+  os << "RUN " << daemon_identity(version) << ' ' << (project.empty() ? "-" : project)
+    << ' ' << args.size() << '\n' << String{cwd} << '\n';
+  for(const auto &arg : args) {
+    os << arg << '\n';
+  }
+  const auto request = os.str();
+
+  std::cout.flush();
+  std::cerr.flush();
+  const int fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+  iovec iov{const_cast<char*>(request.data()), request.size()};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  auto *c = CMSG_FIRSTHDR(&msg);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN(sizeof(fds));
+  std::memcpy(CMSG_DATA(c), fds, sizeof(fds));
+
+  // the stdio goes with the whole request in one message
+  ssize_t r;
+  do {
+    r = sendmsg(fd, &msg, MSG_NOSIGNAL);
+  } while(r < 0 && errno == EINTR);
+  String buffer;
+  Optional<String> reply;
+  if(r != static_cast<ssize_t>(request.size()) || !(reply = read_line(fd, buffer, MAX_REQUEST)) || *reply != "OK") {
+    close(fd);
+    return std::nullopt;
+  }
+
+  // the daemon interrupts the run of the request instead
+  struct sigaction sa{}, old_int{}, old_term{};
+  sa.sa_handler = interrupt_client;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, &old_int);
+  sigaction(SIGTERM, &sa, &old_term);
+
+  int exit_code = 1;
+  while(true) {
+    if(client_interrupted) {
+      client_interrupted = 0;
+      send_all(fd, "INT\n");
+    }
+    pollfd pfd{fd, POLLIN, 0};
+    if(poll(&pfd, 1, DAEMON_POLL_MS) <= 0) continue;
+    const auto line = read_line(fd, buffer, MAX_REQUEST);
+    if(!line) break;
+    const auto tokens = string_tokenize(*line);
+    if(tokens.size() == 2 && tokens[0] == "EXIT") {
+      try {
+        exit_code = std::stoi(tokens[1]);
+      } catch(std::exception&) {}
+      break;
+    }
+  }
+
+  sigaction(SIGINT, &old_int, nullptr);
+  sigaction(SIGTERM, &old_term, nullptr);
+  close(fd);
+  return exit_code;
+}
@@ -0,0 +1,103 @@
+#include "efficiency_report.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+static double seconds_between(std::chrono::system_clock::time_point a, std::chrono::system_clock::time_point b) {
+  return std::chrono::duration<double>(b - a).count();
+}
+
+EfficiencyReport::EfficiencyReport(size_t pool_size)
+: slots(pool_size, SlotStat{0, 0, std::nullopt})
+, start_time(std::chrono::system_clock::now()), end_time(start_time)
+, busy_sec(0), persistence_sec(0)
+, gap_sec(0), gaps(0)
+, longest_name(), longest_sec(0), longest_start() {}
+
+void EfficiencyReport::record(size_t slot, const TestResult &r) {
+  const auto sec = r.duration_sec();
+  auto &s = slots[slot];
+
+  // the time a slot waited for its next test is dispatch latency
+  if(s.last_end) {
+    gap_sec += std::max(0.0, seconds_between(*s.last_end, r.start_time));
+    ++gaps;
+  }
+  s.last_end = r.end_time;
+  s.busy_sec += sec;
+  ++s.tests;
+
+  busy_sec += sec;
+  if(r.testcase.persistence) {
+    persistence_sec += sec;
+  }
+  if(sec > longest_sec) {
+    longest_sec = sec;
+    longest_name = r.testcase.full_name();
+    longest_start = r.start_time;
+  }
+}
+
+void EfficiencyReport::finish() {
+  end_time = std::chrono::system_clock::now();
+}
+
+double EfficiencyReport::makespan_sec() const {
+  return seconds_between(start_time, end_time);
+}
+
+double EfficiencyReport::lower_bound_sec() const {
+  // no schedule beats the longest test, the total work spread over all
+  // slots, nor the persistence tests, which run one at a time
+  return std::max({longest_sec, busy_sec / slots.size(), persistence_sec});
+}
+
+double EfficiencyReport::utilization() const {
+  const auto available = makespan_sec() * slots.size();
+  return available > 0 ? busy_sec / available : 0;
+}
+
+void EfficiencyReport::print(std::ostream &os) const {
+  const auto makespan = makespan_sec();
+  const auto bound = lower_bound_sec();
+  const auto available = makespan * slots.size();
+
+  os << termcolor::bold << "-- Parallel efficiency --" << termcolor::reset << std::endl;
+  os << "Slot busy: " << format_fixed(busy_sec, 1) << "s of " << format_fixed(available, 1)
+    << "s available (" << format_fixed(100 * utilization(), 1) << "% utilization)" << std::endl;
+
+  os << "Idle per slot:";
+  for(size_t i = 0; i < slots.size(); ++i) {
+    os << " " << format_fixed(std::max(0.0, makespan - slots[i].busy_sec), 1) << "s";
+  }
+  os << std::endl;
+
+  if(!longest_name.empty()) {
+    os << "Critical path: " << longest_name << " " << format_fixed(longest_sec, 1) << "s"
+      << ", started at +" << format_fixed(seconds_between(start_time, longest_start), 1) << "s" << std::endl;
+  }
+  if(gaps) {
+    os << "Dispatch latency: " << format_fixed(1000 * gap_sec / gaps, 0) << " ms on average" << std::endl;
+  }
+
+  os << "Makespan: " << format_fixed(makespan, 1) << "s, lower bound " << format_fixed(bound, 1) << "s";
+  if(bound > 0) {
+    os << " (" << format_fixed(100 * (makespan - bound) / bound, 1) << "% above)";
+  }
+  os << std::endl;
+
+  // what bounds the run
+  if(bound <= 0) return;
+  os << termcolor::bright_grey;
+  if(bound == persistence_sec && persistence_sec > longest_sec) {
+    os << "Bound by serialized persistence tests.";
+  } else if(bound == longest_sec) {
+    os << "Bound by the longest test; more jobs won't help";
+    if(seconds_between(start_time, longest_start) > 0.1 * makespan) {
+      os << ", but starting it earlier would (--sort)";
+    }
+    os << ".";
+  } else {
+    os << "Bound by total work; more jobs may help if the machine has idle cores.";
+  }
+  os << termcolor::reset << std::endl;
+}
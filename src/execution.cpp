@@ -4,13 +4,36 @@
 #include <sstream>
 
 #include <thread>
+#include <atomic>
+#include <fstream>
+#include <unordered_map>
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <signal.h>
 
 #include "termcolor/termcolor.hpp"
 #include "execution.h"
 
+static std::atomic<unsigned long> spawn_count{0};
+static thread_local unsigned long spawn_count_here = 0;
+
+static void count_spawn() noexcept {
+  spawn_count.fetch_add(1, std::memory_order_relaxed);
+  ++spawn_count_here;
+}
+
+unsigned long spawned_processes() noexcept {
+  return spawn_count.load(std::memory_order_relaxed);
+}
+
+unsigned long spawned_processes_here() noexcept {
+  return spawn_count_here;
+}
+
 Pair<int, Optional<String>> exec_str(const char *cmd) noexcept {
   FILE *p = nullptr;
   String out;
@@ -21,6 +44,7 @@ Pair<int, Optional<String>> exec_str(const char *cmd) noexcept {
     if (!p) {
       return {-1, std::nullopt};
     }
+    count_spawn();
     while(fgets(buffer.data(), buffer.size(), p) != nullptr) {
       os << buffer.data();
     }
@@ -42,12 +66,137 @@ Pair<int, Optional<String>> exec_str(const char *cmd) noexcept {
   return {-1, std::nullopt};
 }
 
+ResourceUsage::ResourceUsage()
+: user_sec(0), sys_sec(0)
+, max_rss_kb(0)
+, nvcsw(0), nivcsw(0)
+, inblock(0), oublock(0) {}
+
+ResourceUsage& ResourceUsage::operator+=(const ResourceUsage &rhs) {
+  user_sec += rhs.user_sec;
+  sys_sec += rhs.sys_sec;
+  max_rss_kb = std::max(max_rss_kb, rhs.max_rss_kb);
+  nvcsw += rhs.nvcsw;
+  nivcsw += rhs.nivcsw;
+  inblock += rhs.inblock;
+  oublock += rhs.oublock;
+  return *this;
+}
+
+SpawnedProcess::SpawnedProcess()
+: mut(), pid(0) {}
+
+void SpawnedProcess::set(pid_t pid) {
+  std::unique_lock lock{mut};
+  this->pid = pid;
+}
+
+void SpawnedProcess::kill_tree(int sig) {
+  std::unique_lock lock{mut};
+  if(pid <= 0) return;
+
+  // children of each process, from the ppid field of /proc/<pid>/stat
+  std::unordered_multimap<pid_t, pid_t> children;
+  std::error_code ec;
+  for(fs::directory_iterator it("/proc", ec), end; !ec && it != end; it.increment(ec)) {
+    const auto name = it->path().filename().string();
+    if(name.empty() || !std::all_of(name.cbegin(), name.cend(), ::isdigit)) continue;
+    std::ifstream stat_fs{it->path() / "stat"};
+    String stat;
+    if(!std::getline(stat_fs, stat)) continue;
+    // the command may contain spaces; the fields go on after its ')'
+    const auto paren = stat.rfind(')');
+    if(paren == String::npos) continue;
+    std::istringstream fields{stat.substr(paren + 1)};
+    char state;
+    pid_t ppid;
+    if(fields >> state >> ppid) children.emplace(ppid, std::stoi(name));
+  }
+
+  Vector<pid_t> tree{pid};
+  for(size_t i = 0; i < tree.size(); ++i) {
+    const auto [first, last] = children.equal_range(tree[i]);
+    for(auto it = first; it != last; ++it) tree.push_back(it->second);
+  }
+  for(const auto p : tree) {
+    kill(p, sig);
+  }
+}
+
+extern char **environ;
+
+// Same as exec_str, but spawns the shell itself to get its rusage with
+// wait4(2); the counters include every descendant the shell waited for.
+Pair<int, Optional<String>> exec_str(const char *cmd, ResourceUsage &usage, SpawnedProcess *spawned) noexcept {
+  int p[2];
+  // O_CLOEXEC; other threads may spawn at the same time
+  if(pipe2(p, O_CLOEXEC) != 0) {
+    return {-1, std::nullopt};
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, p[1], STDOUT_FILENO);
+
+  pid_t pid;
+  const char *argv[] = {"sh", "-c", cmd, nullptr};
+  const int spawn_ret = posix_spawn(&pid, "/bin/sh", &actions, nullptr,
+    const_cast<char *const *>(argv), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(p[1]);
+  if(spawn_ret != 0) {
+    close(p[0]);
+    return {-1, std::nullopt};
+  }
+  count_spawn();
+  if(spawned) spawned->set(pid);
+
+  String out;
+  bool read_failed = false;
+  try {
+    Buffer buffer;
+    ssize_t r;
+    while((r = read(p[0], buffer.data(), buffer.size())) != 0) {
+      if(r < 0) {
+        if(errno == EINTR) continue;
+        break;
+      }
+      out.append(buffer.data(), r);
+    }
+  } catch(const std::exception& e) {
+    read_failed = true;
+  }
+  close(p[0]);
+  // before the reap, so kill_tree never signals a reused pid
+  if(spawned) spawned->set(0);
+
+  int wret;
+  struct rusage ru;
+  while(wait4(pid, &wret, 0, &ru) < 0) {
+    if(errno != EINTR) return {-1, std::nullopt};
+  }
+
+  usage.user_sec = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+  usage.sys_sec = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+  usage.max_rss_kb = ru.ru_maxrss;
+  usage.nvcsw = ru.ru_nvcsw;
+  usage.nivcsw = ru.ru_nivcsw;
+  usage.inblock = ru.ru_inblock;
+  usage.oublock = ru.ru_oublock;
+
+  if(!read_failed && WIFEXITED(wret)) {
+    return {WEXITSTATUS(wret), std::move(out)};
+  }
+  return {-1, std::nullopt};
+}
+
 int exec_ret(const char *cmd) noexcept {
   Buffer buffer;
   FILE *p = popen(cmd, "r");
   if (!p) {
     return -1;
   }
+  count_spawn();
 
   try {
     while(fgets(buffer.data(), buffer.size(), p) != nullptr);
@@ -67,7 +216,30 @@ int exec_ret(const char *cmd) noexcept {
 const unsigned HARDWARE_CONCURRENCY = std::thread::hardware_concurrency();
 
 
+static thread_local unsigned panic_scopes = 0;
+static std::atomic<PanicHandler> panic_handler{nullptr};
+
+PanicError::PanicError(const String &msg) : std::runtime_error(msg) {}
+
+PanicScope::PanicScope() noexcept {
+  ++panic_scopes;
+}
+
+PanicScope::~PanicScope() noexcept {
+  --panic_scopes;
+}
+
+void set_panic_handler(PanicHandler handler) noexcept {
+  panic_handler = handler;
+}
+
 [[noreturn]] void panic(const std::string& msg, int exit_code) {
+  if(panic_scopes > 0) {
+    throw PanicError(msg);
+  }
+  if(const auto handler = panic_handler.load()) {
+    handler(msg, exit_code);
+  }
   std::cerr << termcolor::red << std::endl << msg << std::endl;
   std::cerr << std::endl << "pincheck exiting with panic.." << std::endl << termcolor::reset;
   std::exit(exit_code);
@@ -0,0 +1,42 @@
+#include "git_worktree.h"
+#include "execution.h"
+#include "string_helper.h"
+
+static String git_or_panic(const Path &dir, const String &args) {
+  std::ostringstream panic_msg;
+  const auto cmd = "git -C " + shell_quote(dir) + " " + args + " 2>&1";
+  const auto res = exec_str(cmd.c_str());
+  if(res.first != 0 || !res.second) {
+    panic_msg << "git command failed: " << cmd;
+    if(res.second) panic_msg << std::endl << *res.second;
+    panic(panic_msg);
+  }
+  return string_trim(*res.second);
+}
+
+String resolve_rev(const Path &src, const String &rev) {
+  return git_or_panic(src, "rev-parse --verify " + shell_quote(rev + "^{commit}"));
+}
+
+Vector<String> rev_list(const Path &src, const String &good, const String &bad) {
+  const auto range = resolve_rev(src, good) + ".." + resolve_rev(src, bad);
+  return string_tokenize(git_or_panic(src, "rev-list --reverse --ancestry-path " + range));
+}
+
+String describe_commit(const Path &src, const String &commit) {
+  return git_or_panic(src, "log -1 --format=" + shell_quote("%h %s") + " " + commit);
+}
+
+Path checkout_worktree(const Path &src, const String &rev, const Path &dir) {
+  const auto commit = resolve_rev(src, rev);
+  // src relative to the top of the repository, e.g. "src/" or ""
+  const auto prefix = git_or_panic(src, "rev-parse --show-prefix");
+
+  if(fs::exists(dir / ".git")) {
+    git_or_panic(dir, "checkout -q -f --detach " + commit);
+  } else {
+    fs::create_directories(dir.parent_path());
+    git_or_panic(src, "worktree add -f --detach " + shell_quote(dir) + " " + commit);
+  }
+  return dir / prefix;
+}
@@ -0,0 +1,164 @@
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "kernel_stats.h"
+#include "string_helper.h"
+
+// the statistics are a few hundred bytes at the end of an .output
+constexpr size_t KERNEL_STATS_TAIL = 4096;
+// a counter grown by this ratio, and by this much, is reported
+constexpr double KERNEL_GROWTH_RATIO = 1.5;
+constexpr long KERNEL_GROWTH_MIN = 5;
+
+bool KernelStats::empty() const {
+  return counters.empty();
+}
+
+Optional<long> KernelStats::get(const String &name) const {
+  const auto it = std::find_if(counters.cbegin(), counters.cend(),
+    [&name](const Pair<String, long> &c){return c.first == name;});
+  if(it == counters.cend()) return std::nullopt;
+  return it->second;
+}
+
+void KernelStats::set(const String &name, long value) {
+  const auto it = std::find_if(counters.begin(), counters.end(),
+    [&name](const Pair<String, long> &c){return c.first == name;});
+  if(it == counters.end()) {
+    counters.emplace_back(name, value);
+  } else {
+    it->second = value;
+  }
+}
+
+KernelStats parse_kernel_stats(const String &output) {
+  KernelStats stats;
+  std::istringstream is(output);
+  String line;
+  while(std::getline(is, line)) {
+    long a, b, c;
+    char disk[32];
+    if(std::sscanf(line.c_str(), "Timer: %ld ticks", &a) == 1) {
+      stats.set("timer_ticks", a);
+    } else if(std::sscanf(line.c_str(), "Thread: %ld idle ticks, %ld kernel ticks, %ld user ticks", &a, &b, &c) == 3) {
+      stats.set("idle_ticks", a);
+      stats.set("kernel_ticks", b);
+      stats.set("user_ticks", c);
+    } else if(std::sscanf(line.c_str(), "%31s %ld reads, %ld writes", disk, &a, &b) == 3) {
+      // "hd0:1:" without the last colon
+      String name = disk;
+      if(!name.empty() && name.back() == ':') name.pop_back();
+      stats.set(name + "_reads", a);
+      stats.set(name + "_writes", b);
+    } else if(std::sscanf(line.c_str(), "Console: %ld characters output", &a) == 1) {
+      stats.set("console_chars", a);
+    } else if(std::sscanf(line.c_str(), "Keyboard: %ld keys pressed", &a) == 1) {
+      stats.set("keys_pressed", a);
+    } else if(std::sscanf(line.c_str(), "Exception: %ld page faults", &a) == 1) {
+      stats.set("page_faults", a);
+    }
+  }
+  return stats;
+}
+
+KernelStats read_kernel_stats(const String &output_file) {
+  const int fd = open(output_file.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return {};
+  }
+
+  struct stat st;
+  const size_t size = (fstat(fd, &st) == 0 && st.st_size > 0) ? st.st_size : 0;
+  const size_t offset = size > KERNEL_STATS_TAIL ? size - KERNEL_STATS_TAIL : 0;
+  String tail(size - offset, '\0');
+
+  size_t done = 0;
+  while(done < tail.size()) {
+    const auto r = pread(fd, tail.data() + done, tail.size() - done, offset + done);
+    if(r <= 0) break;
+    done += r;
+  }
+  close(fd);
+  tail.resize(done);
+
+  return parse_kernel_stats(tail);
+}
+
+bool is_efficiency_counter(const String &name) {
+  const auto ends_with = [&name](const String &suffix) {
+    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+  };
+  return name == "page_faults" || ends_with("_reads") || ends_with("_writes");
+}
+
+Vector<KernelGrowth> kernel_growth(const KernelStats &before, const KernelStats &after) {
+  Vector<KernelGrowth> ret;
+  for(const auto &[name, value] : after.counters) {
+    if(!is_efficiency_counter(name)) continue;
+    const auto prev = before.get(name);
+    if(!prev) continue;
+    if(value - *prev >= KERNEL_GROWTH_MIN && value >= *prev * KERNEL_GROWTH_RATIO) {
+      ret.push_back(KernelGrowth{name, *prev, value});
+    }
+  }
+  return ret;
+}
+
+KernelStatsStore::KernelStatsStore(Path file)
+: entries(), file(std::move(file)) {
+  std::ifstream stats_fs{this->file};
+  if(!stats_fs.is_open()) {
+    return;
+  }
+
+  // <full name> <counter>=<value> ...
+  String line;
+  while(std::getline(stats_fs, line)) {
+    const auto tokens = string_tokenize(line);
+    if(tokens.size() < 2) {
+      continue;
+    }
+
+    KernelStats stats;
+    for(size_t i = 1; i < tokens.size(); ++i) {
+      const auto eq = tokens[i].find('=');
+      if(eq == String::npos) continue;
+      try {
+        stats.set(tokens[i].substr(0, eq), std::stol(tokens[i].substr(eq + 1)));
+      } catch (std::exception&) {
+        continue;
+      }
+    }
+    if(!stats.empty()) {
+      entries[tokens[0]] = std::move(stats);
+    }
+  }
+}
+
+const KernelStats *KernelStatsStore::find(const String &full_name) const {
+  const auto it = entries.find(full_name);
+  return it == entries.end() ? nullptr : &it->second;
+}
+
+void KernelStatsStore::record(const String &full_name, const KernelStats &stats) {
+  if(stats.empty()) return;
+  entries[full_name] = stats;
+}
+
+void KernelStatsStore::save() const {
+  std::ofstream stats_fs{file};
+  if(!stats_fs.is_open()) {
+    return;
+  }
+  for(const auto &[name, stats] : entries) {
+    stats_fs << name;
+    for(const auto &[counter, value] : stats.counters) {
+      stats_fs << ' ' << counter << '=' << value;
+    }
+    stats_fs << '\n';
+  }
+}
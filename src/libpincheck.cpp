@@ -0,0 +1,200 @@
+#include <thread>
+#include <unordered_map>
+
+#include "libpincheck.h"
+#include "common.h"
+#include "check_runner.h"
+#include "test_path.h"
+#include "test_discovery.h"
+#include "test_scheduler.h"
+#include "test_history.h"
+#include "test_runner.h"
+#include "execution.h"
+
+namespace pincheck {
+
+Error::Error(const std::string &msg) : std::runtime_error(msg) {}
+
+static void throw_error(const String &msg, int) {
+  throw Error(msg);
+}
+
+String Test::full_name() const {
+  return subdir + "/" + name;
+}
+
+static Test to_test(const TestCase &t) {
+  return Test{t.subdir, t.name, t.timeout, t.persistence};
+}
+
+struct Project::Impl {
+  TestPath paths;
+  Optional<DiscoveredTests> discovered;
+};
+
+Project::Project(const std::string &src, const std::string &project)
+: impl(std::make_unique<Impl>()) {
+  set_panic_handler(throw_error);
+  impl->paths.src = fs::absolute(src).lexically_normal();
+  impl->paths.project = project;
+  impl->paths.build = impl->paths.src / project / "build";
+}
+
+Project::~Project() = default;
+Project::Project(Project&&) noexcept = default;
+Project& Project::operator=(Project&&) noexcept = default;
+
+bool Project::build(unsigned jobs, std::string &error) {
+  impl->discovered.reset();
+  return make_build(impl->paths, std::max(1u, jobs), error);
+}
+
+std::vector<Test> Project::tests(const Filter &filter) {
+  if(!impl->discovered) {
+    if(!fs::exists(impl->paths.build / "kernel.bin")) {
+      throw Error("Not built: " + String{impl->paths.build});
+    }
+    impl->discovered = discover_tests(impl->paths, TestFilter{}, nullptr);
+  }
+  TestFilter f;
+  if(!filter.tests.empty()) f.names = filter.tests;
+  if(!filter.subdirs.empty()) f.subdirs = filter.subdirs;
+  f.exclude_names = filter.exclude_tests;
+  f.exclude_subdirs = filter.exclude_subdirs;
+  const auto accepted = filter_tests(*impl->discovered, f);
+
+  std::vector<Test> ret;
+  for(const auto *tests : {&accepted.target_tests, &accepted.persistence_tests}) {
+    for(const auto &t : *tests) {
+      ret.push_back(to_test(t));
+    }
+  }
+  return ret;
+}
+
+std::string Project::build_dir() const {
+  return impl->paths.build;
+}
+
+// the dispatching of check_run, without its terminal and reports
+struct Run::Impl {
+  TestPath paths; // runners keep a reference
+  Vector<TestCase> target_tests, persistence_tests;
+  Optional<TestQueue> queue;
+  Optional<TestHistory> history;
+  Vector<std::unique_ptr<TestRunner>> pool;
+  RunOptions options;
+  Callbacks callbacks;
+  bool cancelled, done;
+  Summary sum;
+  std::chrono::steady_clock::time_point start_time;
+};
+
+Run::Run(Project &project, const std::vector<Test> &tests, const RunOptions &options, const Callbacks &callbacks)
+: impl(std::make_unique<Impl>()) {
+  project.tests();
+  const auto &discovered = *project.impl->discovered;
+  std::unordered_map<String, const TestCase*> by_name;
+  for(const auto *v : {&discovered.target_tests, &discovered.persistence_tests}) {
+    for(const auto &t : *v) {
+      by_name.emplace(t.full_name(), &t);
+    }
+  }
+
+  auto &r = *impl;
+  r.paths = project.impl->paths;
+  for(const auto &test : tests) {
+    const auto it = by_name.find(test.full_name());
+    if(it == by_name.end()) {
+      throw Error("No such test in " + String{r.paths.build} + ": " + test.full_name());
+    }
+    (it->second->persistence ? r.persistence_tests : r.target_tests).push_back(*it->second);
+  }
+  if(options.history) {
+    r.history.emplace(r.paths.build / "history.pincheck");
+    order_tests(r.target_tests, TestOrder::history, &*r.history);
+  }
+  r.queue.emplace(r.target_tests, r.persistence_tests);
+  r.pool.resize(std::max(1u, options.slots));
+  r.options = options;
+  r.callbacks = callbacks;
+  r.cancelled = false;
+  r.done = false;
+  r.sum = Summary{};
+  r.start_time = std::chrono::steady_clock::now();
+}
+
+Run::~Run() {
+  if(!impl || impl->done) return;
+  cancel();
+  // the runners are joined as they go
+  impl->pool.clear();
+}
+
+Run::Run(Run&&) noexcept = default;
+Run& Run::operator=(Run&&) noexcept = default;
+
+void Run::step() {
+  auto &r = *impl;
+  if(r.done) return;
+
+  for(auto &p : r.pool) {
+    if(!p || !p->is_finished()) continue;
+    auto results = p->get_results();
+    if(r.history && !results.empty()) r.history->record(results.front());
+    p = nullptr;
+    for(const auto &u : results) {
+      u.passed ? ++r.sum.passed : ++r.sum.failed;
+      if(!r.callbacks.on_result) continue;
+      Result res{to_test(u.testcase), u.passed, u.status(), u.reason(), u.dump,
+        u.duration_sec(), u.run_sec, u.check_sec};
+      r.callbacks.on_result(res, r.callbacks.user);
+    }
+  }
+
+  bool persistence_running = std::any_of(r.pool.cbegin(), r.pool.cend(),
+    [](const std::unique_ptr<TestRunner> &p){return p && p->get_test_case().persistence;});
+  for(auto &p : r.pool) {
+    if(p || r.cancelled || r.queue->empty()) continue;
+    const auto testcase = r.queue->pop(persistence_running);
+    if(!testcase) break;
+    p = std::make_unique<TestRunner>(*testcase);
+    p->register_test(r.paths, r.options.keep_output);
+    persistence_running = persistence_running || testcase->persistence;
+    if(r.callbacks.on_start) r.callbacks.on_start(to_test(*testcase), r.callbacks.user);
+  }
+
+  const bool idle = std::none_of(r.pool.cbegin(), r.pool.cend(), [](const std::unique_ptr<TestRunner> &p){return p != nullptr;});
+  if(idle && (r.cancelled || r.queue->empty())) {
+    r.done = true;
+    r.sum.not_run = r.queue->size();
+    r.sum.sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - r.start_time).count();
+    if(r.history) r.history->save();
+  }
+}
+
+bool Run::poll(std::chrono::milliseconds timeout) {
+  step();
+  if(impl->done) return false;
+  std::this_thread::sleep_for(timeout);
+  step();
+  return !impl->done;
+}
+
+void Run::cancel() {
+  impl->cancelled = true;
+  for(auto &p : impl->pool) {
+    if(p) p->cancel();
+  }
+}
+
+Summary Run::wait() {
+  while(poll(CHECK_POLL_INTERVAL)) {}
+  return impl->sum;
+}
+
+Summary Run::summary() const {
+  return impl->sum;
+}
+
+}
@@ -1,6 +1,11 @@
 #include <fstream>
 #include <map>
 #include <random>
+#include <thread>
+#include <unordered_set>
+#include <csignal>
+#include <cstring>
+#include <sys/wait.h>
 
 #include "termcolor/termcolor.hpp"
 
@@ -10,42 +15,72 @@
 #include "execution.h"
 #include "test_path.h"
 #include "rubric_parse.h"
+#include "test_discovery.h"
 
 #include "test_runner.h"
 #include "test_result.h"
 
 #include "check_runner.h"
+#include "test_history.h"
+#include "test_scheduler.h"
+#include "run_simulator.h"
+#include "trace_log.h"
+#include "self_profile.h"
+#include "ab_runner.h"
+#include "bisect_runner.h"
+#include "batch_runner.h"
+#include "test_shard.h"
+#include "remote_worker.h"
+#include "run_metrics.h"
+#include "daemon_server.h"
+#include "tree_watch.h"
+#include "control_socket.h"
+#include "result_report.h"
+#include "git_worktree.h"
 #include "just_runner.h"
 #include "gdb_runner.h"
 
 #include "string_helper.h"
 #include "console_helper.h"
 
-const char *PINCHECK_VERSION = "v21.11.09";
-
 enum class PincheckMode {
-  check, run, gdb
+  check, run, gdb, simulate, ab, bisect
 };
 
-struct CacheEntry {
-  bool persistence;
-  int timeout;
-};
+// the directory pincheck was invoked from; it moves to the build directory later
+static Path invocation_path;
+static Path user_path(const String &p);
+// failures of the previous run of --watch, run before the other tests
+static std::unordered_set<String> watch_failed;
+// of the last discover_tests, for --metrics
+static double discovery_sec = 0;
+static TestFilter parse_test_filter(argparse::ArgumentParser &program);
 
-static int parse_timeout(const String &command);
-static Optional<String> get_raw_running_command(const String &full_name);
 static String get_running_command(const String &full_name, bool gdb_opt, bool timeout_opt);
 
-static int run_mode_check (argparse::ArgumentParser &program, const TestPath &paths, const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests);
+static int finish_run(argparse::ArgumentParser &program, TraceLog *trace, SelfProfile *profile, std::chrono::system_clock::time_point pincheck_start, int exit_code);
+static int run_tests(argparse::ArgumentParser &program, const TestPath &paths, DiscoveredTests discovered, TestHistory &history, KernelStatsStore &kernel_stats, TraceLog *trace, SelfProfile *profile);
+static bool can_use_daemon(argparse::ArgumentParser &program);
+static int serve_daemon_request(DaemonState &state, const Vector<String> &args, const Path &cwd);
+static DiscoveredTests timed_discovery(const TestPath &paths, const TestFilter &filter, SelfProfile *profile);
+static void open_metrics(argparse::ArgumentParser &program, Optional<RunMetrics> &metrics);
+static String worker_token(argparse::ArgumentParser &program);
+
+static int run_mode_check (argparse::ArgumentParser &program, const TestPath &paths, const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests, TraceLog *trace, SelfProfile *profile, TestHistory &history, KernelStatsStore &kernel_stats);
 static int run_mode_run (argparse::ArgumentParser &program, const Vector<TestCase> &target_tests);
 static int run_mode_gdb (argparse::ArgumentParser &program, const Vector<TestCase> &target_tests);
+static int run_mode_ab (argparse::ArgumentParser &program, const TestPath &paths, const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests);
+static int run_mode_bisect (argparse::ArgumentParser &program, const TestPath &paths, const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests);
+static int run_mode_batch (argparse::ArgumentParser &program, const Path &src);
+static int run_mode_watch (argparse::ArgumentParser &program, TestPath &paths);
+static Vector<String> parse_projects(const String &s);
 
 int main(int argc, char *argv[]) {
   using namespace std::string_literals;
   std::ostringstream panic_msg;
-  auto mode = PincheckMode::check;
 
   const std::chrono::system_clock::time_point pincheck_start = std::chrono::system_clock::now();
+  invocation_path = fs::current_path();
 
   std::cout << termcolor::reset;
   std::cerr << termcolor::reset;
@@ -54,166 +89,211 @@ int main(int argc, char *argv[]) {
   parse_args(program, argc, argv);
   const auto is_verbose = program.get<bool>("--verbose");
 
+  if(program.is_used("--control")) {
+    return control_client(invocation_path,
+      program.is_used("--project") ? program.get<String>("--project") : "", program.get<String>("--control"));
+  }
+
+  // a daemon of this tree skips detection, build and discovery
+  if(!program.get<bool>("--no-daemon") && can_use_daemon(program)) {
+    const auto project = program.is_used("--project") ? program.get<String>("--project") : "";
+    if(const auto socket = find_daemon_socket(invocation_path, project)) {
+      if(const auto exit_code = daemon_client(*socket, PINCHECK_VERSION, project,
+          Vector<String>(argv, argv + argc), invocation_path)) {
+        return *exit_code;
+      }
+    }
+  }
+
+  Optional<TraceLog> trace;
+  if(program.is_used("--trace")) {
+    trace.emplace();
+  }
+  TraceLog *trace_ptr = trace ? &*trace : nullptr;
+  Optional<SelfProfile> profile;
+  if(program.get<bool>("--self-profile")) {
+    profile.emplace();
+  }
+  SelfProfile *profile_ptr = profile ? &*profile : nullptr;
+
+  Optional<TraceScope> phase;
+  Optional<ProfileScope> phase_profile;
+  const auto begin_phase = [&](const String &name) {
+    phase.emplace(trace_ptr, name);
+    phase_profile.emplace(profile_ptr, name);
+  };
+  const auto end_phase = [&]() {
+    phase_profile.reset();
+    phase.reset();
+  };
+  const auto finish = [&](int exit_code) {
+    return finish_run(program, trace_ptr, profile_ptr, pincheck_start, exit_code);
+  };
+
   std::random_device rd;
   std::mt19937 gen(rd());
   if (std::bernoulli_distribution d(1.0/4);
     (program.get<bool>("-fv") || d(gen)) && !program.get<bool>("-nv")) {
+    begin_phase("version check");
     check_new_version(is_verbose);
+    end_phase();
+  }
+
+  if(program.is_used("--worker")) {
+    Path cache;
+    if(program.is_used("--worker-cache")) {
+      cache = user_path(program.get<String>("--worker-cache"));
+    } else if(const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+      cache = Path{xdg} / "pincheck-worker";
+    } else if(const char *home = std::getenv("HOME"); home && *home) {
+      cache = Path{home} / ".cache" / "pincheck-worker";
+    } else {
+      cache = user_path(".pincheck-worker");
+    }
+    return finish(worker_serve(program.get<String>("--worker"),
+      std::max(1u, program.get<unsigned>("--worker-slots")), cache, worker_token(program)));
+  }
+
+  if(program.is_used("--merge")) {
+    Vector<Path> files;
+    for(const auto &f : program.get<Vector<String>>("--merge")) {
+      files.push_back(user_path(f));
+    }
+    Optional<Path> out;
+    if(program.is_used("--report-json")) {
+      out = user_path(program.get<String>("--report-json"));
+    }
+    return finish(merge_shards(files, out));
+  }
+
+  // other trees than the one of pintos in PATH
+  if(program.is_used("--batch")) {
+    begin_phase("batch");
+    const auto exit_code = run_mode_batch(program, {});
+    end_phase();
+    return finish(exit_code);
   }
 
   TestPath paths;
+  begin_phase("detect_src");
   detect_src(paths);
+  end_phase();
   if(is_verbose) {
     std::cout << "Pintos Src: " << std::string{paths.src} << std::endl;
   }
 
-  if(program.is_used("--project")) {
-    paths.project = program.get<String>("--project");
-  } else {
-    detect_project(paths);
-  }
-  constexpr std::array<const char*, 4> all_proj = {"threads", "userprog", "vm", "filesys"};
-  if(std::find(all_proj.cbegin(), all_proj.cend(), paths.project) == all_proj.cend()) {
-    panic_msg << "The detected or given project name is not thread, userprog, vm, nor filesys.\n";
-    panic_msg << "Please move path to any project directory or its build directory.";
-    panic(panic_msg);
+  const auto projects = parse_projects(program.is_used("--project")
+    ? program.get<String>("--project") : detect_project(paths));
+  // several projects of this tree through one pool
+  if(projects.size() > 1) {
+    begin_phase("batch");
+    const auto exit_code = run_mode_batch(program, paths.src);
+    end_phase();
+    return finish(exit_code);
   }
+  paths.project = projects.front();
   if(is_verbose) {
     std::cout << "Pintos Project: " << paths.project << std::endl;
   }
 
+  begin_phase("detect_build");
   detect_build(paths, is_verbose, program.get<bool>("--clean-build"));
+  end_phase();
   if(is_verbose) {
     std::cout << "Pintos Build for " << paths.project << ": " << std::string{paths.build} << std::endl;
   }
 
   fs::current_path(paths.build);
-  std::ofstream make_pincheck{"Make.pincheck"};
-  if(!make_pincheck.is_open()){
-    panic_msg << "Cannot make temp file to extract list of tests.";
-    panic(panic_msg);
+
+  if(program.get<bool>("--daemon")) {
+    return finish(daemon_serve(paths, PINCHECK_VERSION, serve_daemon_request));
   }
-  make_pincheck
-    << "# -*- makefile -*-\n\n"
-    << "SRCDIR = ../..\n\n"
-    << ".PHONY: tests grade_file\n\n"
-    << "tests:\n\t@echo $(TESTS) $(EXTRA_GRADES) "
-    << "$(foreach subdir,$(TEST_SUBDIRS),$($(subdir)_GRADES))\n\n"
-    << "grade_file:\n\t@echo $(GRADING_FILE)\n\n"
-    << "include ../../Make.config\n"
-    << "include ../Make.vars\n"
-    << "include ../../tests/Make.tests\n";
-  make_pincheck.close();
-
-  const auto make_tests_res = exec_str("make tests --silent -f Make.pincheck");
-  if (make_tests_res.first != 0 || !make_tests_res.second.has_value()) {
-    panic_msg << "Cannot extract list of tests.";
-    panic(panic_msg);
+  if(program.get<bool>("--watch")) {
+    return finish(run_mode_watch(program, paths));
   }
-  const auto all_tests = string_tokenize(*make_tests_res.second);
 
-  // pincheck cache
-  std::ifstream cache_file_input{"cache.pincheck"};
-  std::unordered_map<String, CacheEntry> cache_map;
-  if(cache_file_input.is_open()) {
-    String line;
-    while(std::getline(cache_file_input, line)) {
-      auto tokens = string_tokenize(line);
-      if(tokens.size() != 3) {
-        continue;
-      }
+  std::cout << "Extracting list of tests. May take some times..." << std::endl;
+  begin_phase("discovery");
+  const auto discovered = timed_discovery(paths, parse_test_filter(program), profile_ptr);
 
-      bool persistence;
-      int timeout;
-      try {
-        persistence = (std::stoi(tokens[1]) != 0);
-        timeout = std::stoi(tokens[2]);
-      } catch (std::exception&) {
-        continue;
-      }
-      cache_map[tokens[0]] = CacheEntry{.persistence = persistence, .timeout = timeout};
-    }
-    cache_file_input.close();
-  }
+  Optional<ProfileScope> step_profile;
+  step_profile.emplace(profile_ptr, "history load");
+  TestHistory history{paths.build / "history.pincheck"};
+  KernelStatsStore kernel_stats{paths.build / "kernel_stats.pincheck"};
+  step_profile.reset();
 
-  std::cout << "Extracting list of tests. May take some times..." << std::endl;
-  Vector<TestCase> target_tests{};
-  Vector<TestCase> persistence_tests{};
-  const auto name_patterns = program.get<Vector<String>>("--");
-  const auto subdir_patterns = program.get<Vector<String>>("--subdir");
-  const auto name_ex_patterns = program.get<Vector<String>>("--exclude");
-  const auto subdir_ex_patterns = program.get<Vector<String>>("--subdir-exclude");
-  for(const auto& _test : all_tests) {
-    const auto& test = string_trim(_test);
-
-    const auto test_path = Path{test};
-    auto name = String{test_path.filename()};
-    auto subdir = String{test_path.parent_path()};
-
-    if(!wildcard_match(subdir, subdir_patterns) ||
-       !wildcard_match(name, name_patterns) ||
-       wildcard_match(subdir, subdir_ex_patterns) ||
-       wildcard_match(name, name_ex_patterns)) continue;
-
-    TestCase here(std::move(subdir), std::move(name));
-
-    auto cache_it = cache_map.find(here.full_name());
-    bool add_to_cache = false;
-    if(cache_it != cache_map.end()) {
-      here.timeout = cache_it->second.timeout;
-      here.persistence = cache_it->second.persistence;
-    } else {
-      const auto opt_cmd = get_raw_running_command(here.full_name());
-      if(!opt_cmd) {
-        auto pers_it = std::find(all_tests.cbegin(), all_tests.cend(), here.full_name() + "-persistence");
-        if(pers_it != all_tests.cend()) {
-          here.persistence = true;
-          here.timeout = 60;
-        } else {
-          continue;
-        }
-      } else {
-        here.timeout = parse_timeout(*opt_cmd);
-      }
+  end_phase();
 
-      add_to_cache = true;
-    }
+  return finish(run_tests(program, paths, discovered, history, kernel_stats, trace_ptr, profile_ptr));
+}
 
-    if (here.persistence) {
-      persistence_tests.push_back(here);
-    } else {
-      target_tests.push_back(here);
+/** Implementation parts */
+
+static int finish_run(argparse::ArgumentParser &program, TraceLog *trace, SelfProfile *profile, std::chrono::system_clock::time_point pincheck_start, int exit_code) {
+  if(trace) {
+    trace->span("pincheck", "pincheck", 0, pincheck_start, std::chrono::system_clock::now());
+    trace->write(user_path(program.get<String>("--trace")));
+  }
+  if(profile) {
+    std::cout << std::endl;
+    profile->print(std::cout);
+  }
+
+  const std::chrono::system_clock::time_point pincheck_end = std::chrono::system_clock::now();
+  std::cout << "pincheck exiting with code " << exit_code
+    << " (Running time: " << std::chrono::duration_cast<std::chrono::seconds>(pincheck_end-pincheck_start).count() << " sec)" << std::endl;
+  return exit_code;
+}
+
+static int run_tests(argparse::ArgumentParser &program, const TestPath &paths, DiscoveredTests discovered, TestHistory &history, KernelStatsStore &kernel_stats, TraceLog *trace, SelfProfile *profile) {
+  std::ostringstream panic_msg;
+  const auto is_verbose = program.get<bool>("--verbose");
+  auto mode = PincheckMode::check;
+  auto &target_tests = discovered.target_tests;
+  const auto &persistence_tests = discovered.persistence_tests;
+  if(program.is_used("--shard")) {
+    const auto shard_str = program.get<String>("--shard");
+    const auto shard = parse_shard(shard_str);
+    if(!shard) {
+      panic_msg << "The shard must be i/n with 1 <= i <= n: " << shard_str;
+      panic(panic_msg);
     }
-    if(add_to_cache) {
-      CacheEntry entry;
-      entry.persistence = here.persistence;
-      entry.timeout = here.timeout;
-      cache_map[here.full_name()] = entry;
+    Optional<TestHistory> shard_history;
+    if(program.is_used("--shard-history")) {
+      const auto file = user_path(program.get<String>("--shard-history"));
+      if(!fs::exists(file)) {
+        panic_msg << "Cannot find the shard history " << file;
+        panic(panic_msg);
+      }
+      shard_history.emplace(file);
     }
+    const auto loads = select_shard(target_tests, discovered.persistence_tests, *shard,
+      shard_history ? &*shard_history : nullptr);
+    std::cout << "Shard " << shard->index << "/" << shard->count << ": "
+      << format_fixed(loads[shard->index - 1], 1) << " sec of tests, the heaviest shard "
+      << format_fixed(*std::max_element(loads.cbegin(), loads.cend()), 1) << " sec"
+      << (shard_history ? "" : " (by TIMEOUT)") << std::endl;
   }
-  std::ofstream cache_file_output{"cache.pincheck"};
-  if(cache_file_output.is_open()) {
-    std::cout << "cache storing..\n";
-    for(const auto &[s, e]: cache_map) {
-      cache_file_output << s << ' ' << static_cast<int>(e.persistence) << ' ' << e.timeout << '\n';
-    }
-    cache_file_output.close();
+
+  const auto order_str = program.get<String>("--order");
+  auto order = parse_test_order(order_str);
+  if(!order) {
+    panic_msg << "Unknown test order: " << order_str;
+    panic(panic_msg);
   }
   if(program.get<bool>("--sort")) {
-    std::sort(target_tests.rbegin(), target_tests.rend());
+    order = TestOrder::timeout;
+  }
+  if(!program.get<bool>("--simulate")) {
+    order_tests(target_tests, *order, &history);
   }
+  std::stable_partition(target_tests.begin(), target_tests.end(),
+    [](const TestCase &t){return watch_failed.count(t.full_name()) > 0;});
 
   const auto full_test_size = target_tests.size() + 2 * persistence_tests.size();
   std::cout << std::endl;
   std::cout << termcolor::bold << "Total " << full_test_size << " tests found." << termcolor::reset << std::endl;
 
-  const auto grade_file_res = exec_str("make grade_file --silent -f Make.pincheck");
-  if (grade_file_res.first != 0 || !grade_file_res.second.has_value()) {
-    panic_msg << "Cannot extract the name of grading file.";
-    panic(panic_msg);
-  }
-  auto rubrics = parse_rubric(string_trim(*grade_file_res.second), target_tests, persistence_tests);
-
   if (is_verbose) {
     std::cout << "-- Target tests --" << std::endl;
     for(const auto& test_case : target_tests) {
@@ -235,6 +315,12 @@ int main(int argc, char *argv[]) {
     mode = PincheckMode::run;
   } else if(program.is_used("--gdb-run")) {
     mode = PincheckMode::gdb;
+  } else if(program.get<bool>("--simulate")) {
+    mode = PincheckMode::simulate;
+  } else if(program.is_used("--ab") || program.is_used("--ab-rev")) {
+    mode = PincheckMode::ab;
+  } else if(program.is_used("--bisect")) {
+    mode = PincheckMode::bisect;
   }
 
   //--------------------------------------------------------
@@ -250,91 +336,499 @@ int main(int argc, char *argv[]) {
       break;
     
     case PincheckMode::check:
-      exit_code = run_mode_check (program, paths, target_tests, persistence_tests);
+      exit_code = run_mode_check (program, paths, target_tests, persistence_tests, trace, profile, history, kernel_stats);
+      break;
+
+    case PincheckMode::simulate:
+    {
+      TraceScope phase(trace, "simulate");
+      ProfileScope phase_profile(profile, "simulate");
+      exit_code = simulate(target_tests, persistence_tests, history,
+        std::max(program.get<unsigned>("-j"), 2 * HARDWARE_CONCURRENCY));
+      break;
+    }
+
+    case PincheckMode::ab:
+      exit_code = run_mode_ab (program, paths, target_tests, persistence_tests);
+      break;
+
+    case PincheckMode::bisect:
+      exit_code = run_mode_bisect (program, paths, target_tests, persistence_tests);
       break;
     
     default:
       panic("Unsupported running mode");
   }
 
-  const std::chrono::system_clock::time_point pincheck_end = std::chrono::system_clock::now();
-  std::cout << "pincheck exiting with code " << exit_code
-    << " (Running time: " << std::chrono::duration_cast<std::chrono::seconds>(pincheck_end-pincheck_start).count() << " sec)" << std::endl;
   return exit_code;
 }
 
-/** Implementation parts */
 
-static int run_mode_check (argparse::ArgumentParser &program, const TestPath &paths, const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests) {
-  const auto is_verbose = program.get<bool>("--verbose");
-  const auto pool_size = program.get<unsigned>("-j");
+static int run_mode_check (argparse::ArgumentParser &program, const TestPath &paths, const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests, TraceLog *trace, SelfProfile *profile, TestHistory &history, KernelStatsStore &kernel_stats) {
+  std::ostringstream panic_msg;
+  CheckOption opt;
+  opt.is_verbose = program.get<bool>("--verbose");
+  opt.pool_size = program.get<unsigned>("-j");
+  opt.repeats = program.get<unsigned>("--repeat");
+
+  opt.until_fail = program.get<bool>("--repeat-until-fail");
+  if(program.is_used("--soak")) {
+    const auto soak_str = program.get<String>("--soak");
+    opt.soak = parse_duration(soak_str);
+    if(!opt.soak) {
+      panic_msg << "Cannot parse the soak duration: " << soak_str << "; give a positive one such as 90s, 30m or 1h30m";
+      panic(panic_msg);
+    }
+  }
+  if(opt.is_soak() && !program.is_used("--repeat")) {
+    opt.repeats = 0;
+  }
+  opt.soak_dir = program.is_used("--soak-dir")
+    ? user_path(program.get<String>("--soak-dir"))
+    : paths.build / "soak.pincheck";
+
+  if(program.is_used("--report-json")) {
+    opt.report_json = user_path(program.get<String>("--report-json"));
+  } else if(program.get<bool>("--watch")) {
+    // where run_mode_watch reads the failures from
+    opt.report_json = paths.build / "watch.pincheck";
+  }
+  if(program.is_used("--junit")) {
+    opt.junit = user_path(program.get<String>("--junit"));
+  }
+  opt.trace = trace;
+  opt.profile = profile;
+  Optional<RemotePool> remote;
+  if(program.is_used("--remote")) {
+    remote.emplace(program.get<Vector<String>>("--remote"), worker_token(program));
+    remote->print(std::cout);
+    opt.remote = &*remote;
+  }
+  opt.history = &history;
+  opt.kernel_stats = &kernel_stats;
+  Optional<RunMetrics> metrics;
+  open_metrics(program, metrics);
+  opt.metrics = metrics ? &*metrics : nullptr;
+
+  if(program.is_used("--baseline")) {
+    const auto baseline_str = program.get<String>("--baseline");
+    const auto baseline = parse_baseline_mode(baseline_str);
+    if(!baseline) {
+      panic_msg << "Unknown baseline mode: " << baseline_str << " (save or compare)";
+      panic(panic_msg);
+    }
+    opt.baseline = *baseline;
+  }
+  opt.baseline_file = program.is_used("--baseline-file")
+    ? user_path(program.get<String>("--baseline-file"))
+    : paths.build / "baseline.pincheck";
+  opt.baseline_fail = program.get<bool>("--baseline-fail");
+
+  const auto ret = check_run(paths, target_tests, persistence_tests, opt);
+  if(remote) {
+    std::cout << std::endl;
+    remote->print(std::cout);
+  }
+  return ret;
+}
 
-  const auto repeats = program.get<unsigned>("--repeat");
-  return check_run(paths, target_tests, persistence_tests, is_verbose, pool_size, repeats);
+static Path user_path(const String &p) {
+  return invocation_path / p;
 }
 
-static auto get_target_test_or_panic(const String &t, const Vector<TestCase> &target_tests) {
+static DiscoveredTests timed_discovery(const TestPath &paths, const TestFilter &filter, SelfProfile *profile) {
+  const auto start = std::chrono::steady_clock::now();
+  auto ret = discover_tests(paths, filter, profile);
+  discovery_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return ret;
+}
+
+static void open_metrics(argparse::ArgumentParser &program, Optional<RunMetrics> &metrics) {
+  if(!program.is_used("--metrics") && !program.is_used("--metrics-port")) return;
+  Optional<Path> file;
+  Optional<unsigned> port;
+  if(program.is_used("--metrics")) file = user_path(program.get<String>("--metrics"));
+  if(program.is_used("--metrics-port")) port = program.get<unsigned>("--metrics-port");
+  metrics.emplace(file, port);
+  metrics->discovery(discovery_sec);
+}
+
+// a worker runs what it is sent, so neither end goes without the secret
+static String worker_token(argparse::ArgumentParser &program) {
+  String token;
+  if(program.is_used("--worker-token")) {
+    token = program.get<String>("--worker-token");
+  } else if(const char *env = std::getenv("PINCHECK_WORKER_TOKEN")) {
+    token = env;
+  }
+  if(token.empty() || std::any_of(token.cbegin(), token.cend(), [](char c){return std::isspace(static_cast<unsigned char>(c));})) {
+    panic("--worker and --remote need a token without spaces, by --worker-token or PINCHECK_WORKER_TOKEN.");
+  }
+  return token;
+}
+
+static TestFilter parse_test_filter(argparse::ArgumentParser &program) {
+  TestFilter filter;
+  filter.names = program.get<Vector<String>>("--");
+  filter.subdirs = program.get<Vector<String>>("--subdir");
+  filter.exclude_names = program.get<Vector<String>>("--exclude");
+  filter.exclude_subdirs = program.get<Vector<String>>("--subdir-exclude");
+  return filter;
+}
+
+static int run_mode_ab (argparse::ArgumentParser &program, const TestPath &paths, const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests) {
   std::ostringstream panic_msg;
-  auto it = std::find_if(target_tests.cbegin(), target_tests.cend(), [&t](const TestCase &here){
-    return t == here.name || t == here.full_name();
-  });
-  if(it == target_tests.cend()) {
-    panic_msg << "Cannot find the case named " << t;
+  const auto is_verbose = program.get<bool>("--verbose");
+
+  TestPath b;
+  b.project = paths.project;
+  if(program.is_used("--ab-rev")) {
+    const auto rev = program.get<String>("--ab-rev");
+    const auto commit = resolve_rev(paths.src, rev);
+    std::cout << "Checking out " << rev << " (" << commit.substr(0, 12) << ") for B..." << std::endl;
+    b.src = checkout_worktree(paths.src, commit, paths.build / "ab.pincheck" / commit.substr(0, 12));
+  } else {
+    // a pintos src, one of its project directories, or a build directory of them
+    auto dir = fs::absolute(user_path(program.get<String>("--ab"))).lexically_normal();
+    if(dir.filename().empty()) dir = dir.parent_path();
+    if(dir.filename() == "build") dir = dir.parent_path();
+    if(fs::exists(dir / "Make.vars")) dir = dir.parent_path();
+    if(!fs::is_directory(dir / b.project)) {
+      panic_msg << "Cannot find the " << b.project << " project for B in " << dir;
+      panic(panic_msg);
+    }
+    b.src = dir;
+  }
+
+  std::cout << "Building B..." << std::endl;
+  detect_build(b, is_verbose, program.get<bool>("--clean-build"));
+  if(fs::equivalent(b.build, paths.build)) {
+    panic_msg << "A and B are the same build: " << paths.build;
     panic(panic_msg);
   }
 
-  return it;
+  AbOption opt;
+  opt.is_verbose = is_verbose;
+  opt.pool_size = program.get<unsigned>("-j");
+  opt.rounds = std::max(1u, program.get<unsigned>("--ab-rounds"));
+  return ab_run(paths, b, target_tests, persistence_tests, opt);
 }
 
-static int parse_timeout(const String &command) {
-  constexpr int DEFAULT_TIMEOUT = 60;
-  const auto tokens = string_tokenize(command);
+static int run_mode_bisect (argparse::ArgumentParser &program, const TestPath &paths, const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests) {
+  BisectOption opt;
+  opt.slots = program.get<unsigned>("-j");
+  opt.repeats = std::max(1u, program.get<unsigned>("--bisect-repeat"));
+  return bisect_run(paths, program.get<String>("--bisect"), target_tests, persistence_tests, opt);
+}
 
-  auto it = std::find(tokens.cbegin(), tokens.cend(), "-T");
-  if(it == tokens.cend()) {
-    return DEFAULT_TIMEOUT;
+// the trees of --batch, or src for the projects of this tree
+static int run_mode_batch (argparse::ArgumentParser &program, const Path &src) {
+  std::ostringstream panic_msg;
+  if(!program.is_used("--project")) {
+    panic("--batch needs the project given by -p.");
+  }
+  for(const auto *name : {"--just-run", "--gdb-run", "--simulate", "--ab", "--ab-rev", "--bisect",
+    "--watch", "--daemon", "--shard", "--remote", "--report-json", "--junit", "--baseline",
+    "--repeat", "--repeat-until-fail", "--soak", "--order", "--sort", "--clean-build"}) {
+    if(program.is_used(name)) {
+      panic_msg << (src.empty() ? "--batch" : "Several projects") << " run each test once through one pool; "
+        << "it cannot be used with " << name << (src.empty() ? "" : "; give one project with -p");
+      panic(panic_msg);
+    }
+  }
+  const auto projects = parse_projects(program.get<String>("--project"));
+
+  BatchOption opt;
+  opt.is_verbose = program.get<bool>("--verbose");
+  opt.pool_size = program.get<unsigned>("-j");
+  opt.builds = program.get<unsigned>("--batch-builds");
+  opt.filter = parse_test_filter(program);
+  if(program.is_used("--batch-report")) {
+    opt.report_json = user_path(program.get<String>("--batch-report"));
+  }
+  Optional<RunMetrics> metrics;
+  open_metrics(program, metrics);
+  opt.metrics = metrics ? &*metrics : nullptr;
+
+  Vector<BatchUnit> units;
+  const auto add_tree = [&](const String &label, const Path &path) {
+    for(const auto &project : projects) {
+      BatchUnit unit;
+      unit.label = projects.size() > 1 ? label + ":" + project : label;
+      unit.paths.project = project;
+      // a pintos src, or a checkout with it in src
+      auto dir = fs::absolute(path).lexically_normal();
+      if(!fs::is_directory(dir / project) && fs::is_directory(dir / "src" / project)) {
+        dir /= "src";
+      }
+      unit.paths.src = dir;
+      units.push_back(std::move(unit));
+    }
+  };
+  if(!src.empty()) {
+    for(const auto &project : projects) {
+      BatchUnit unit;
+      unit.label = project;
+      unit.paths.src = src;
+      unit.paths.project = project;
+      units.push_back(std::move(unit));
+    }
+    opt.unit_name = "project";
+    return batch_run(units, opt);
+  }
+  for(const auto &arg : program.get<Vector<String>>("--batch")) {
+    const auto p = user_path(arg);
+    if(fs::is_directory(p)) {
+      add_tree(arg, p);
+      continue;
+    }
+    std::ifstream list{p};
+    if(!list.is_open()) {
+      panic_msg << "Cannot open the list of trees: " << p;
+      panic(panic_msg);
+    }
+    String line;
+    while(std::getline(list, line)) {
+      line = string_trim(line.substr(0, line.find('#')));
+      // relative to the list
+      if(!line.empty()) add_tree(line, p.parent_path() / line);
+    }
+  }
+  if(units.empty()) {
+    panic("No tree to grade in --batch.");
   }
 
-  ++it;
-  if(it == tokens.cend()) {
-    return DEFAULT_TIMEOUT;
+  return batch_run(units, opt);
+}
+
+static volatile std::sig_atomic_t watch_interrupted = 0;
+
+static void interrupt_watch(int) {
+  watch_interrupted = 1;
+}
+
+// interrupts a run and the processes of its group, killing them after a grace period
+static int stop_run(pid_t pid) {
+  constexpr auto GRACE = std::chrono::seconds(2);
+  kill(-pid, SIGINT);
+  const auto deadline = std::chrono::steady_clock::now() + GRACE;
+  siginfo_t info{};
+  while(std::chrono::steady_clock::now() < deadline) {
+    info.si_pid = 0;
+    if(waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == pid) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
   }
+  // the run is not reaped yet, so its group cannot be reused
+  kill(-pid, SIGKILL);
+  int status;
+  waitpid(pid, &status, 0);
+  return 130;
+}
 
-  int ret;
-  try {
-    ret = std::stoi(*it);
-  } catch (const std::exception &e) {
-    ret = DEFAULT_TIMEOUT;
+// Runs the check mode in a child of its own process group, building again
+// and running once more whenever the sources change. A change during a run
+// cancels it; the failures of a run go first in the next one.
+static int run_mode_watch (argparse::ArgumentParser &program, TestPath &paths) {
+  std::ostringstream panic_msg;
+  for(const auto *name : {"--just-run", "--gdb-run", "--simulate", "--ab", "--ab-rev", "--bisect"}) {
+    if(program.is_used(name)) {
+      panic_msg << "--watch runs the check mode only; it cannot be used with " << name;
+      panic(panic_msg);
+    }
+  }
+  // each run is a child process, which would take what they record with it
+  for(const auto *name : {"--trace", "--self-profile"}) {
+    if(program.is_used(name)) {
+      panic_msg << "--watch runs each check in a process of its own; it cannot be used with " << name;
+      panic(panic_msg);
+    }
   }
 
-  return ret;
+  const auto filter = parse_test_filter(program);
+  const auto report = program.is_used("--report-json")
+    ? user_path(program.get<String>("--report-json"))
+    : paths.build / "watch.pincheck";
+  TreeWatch watch{paths.src};
+  signal(SIGINT, interrupt_watch);
+  signal(SIGTERM, interrupt_watch);
+
+  int exit_code = 0;
+  bool built = true;
+  Vector<Path> changed;
+  while(!watch_interrupted) {
+    if(built) {
+      std::cout << "Extracting list of tests. May take some times..." << std::endl;
+      const auto discovered = timed_discovery(paths, filter, nullptr);
+      TestHistory history{paths.build / "history.pincheck"};
+      KernelStatsStore kernel_stats{paths.build / "kernel_stats.pincheck"};
+      fs::remove(report);
+
+      std::cout.flush();
+      const pid_t pid = fork();
+      if(pid == 0) {
+        setpgid(0, 0);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        std::exit(run_tests(program, paths, discovered, history, kernel_stats, nullptr, nullptr));
+      }
+      if(pid < 0) {
+        panic_msg << "Cannot fork for the run: " << std::strerror(errno);
+        panic(panic_msg);
+      }
+      setpgid(pid, pid);
+
+      while(true) {
+        int status;
+        if(waitpid(pid, &status, WNOHANG) == pid) {
+          exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+          break;
+        }
+        if(watch_interrupted) {
+          exit_code = stop_run(pid);
+          break;
+        }
+        changed = watch.wait(CHECK_POLL_INTERVAL);
+        if(!changed.empty()) {
+          exit_code = stop_run(pid);
+          std::cout << std::endl << termcolor::yellow << "Sources changed; the run is cancelled."
+            << termcolor::reset << std::endl;
+          break;
+        }
+      }
+
+      // a cancelled run keeps the failures of the tests it did not finish
+      std::ifstream is{report};
+      String line;
+      while(std::getline(is, line)) {
+        const auto name = json_field(line, "name"), subdir = json_field(line, "subdir");
+        const auto passed = json_field(line, "passed");
+        if(!name || !subdir || !passed) continue;
+        // a persistence pair is failing as its base test
+        auto full_name = *subdir + "/" + *name;
+        const String suffix = "-persistence";
+        if(full_name.size() > suffix.size()
+          && full_name.compare(full_name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+          full_name.resize(full_name.size() - suffix.size());
+        }
+        if(*passed == "true") {
+          watch_failed.erase(full_name);
+        } else {
+          watch_failed.insert(full_name);
+        }
+      }
+    }
+
+    if(changed.empty() && !watch_interrupted) {
+      std::cout << std::endl << termcolor::bold << "Watching " << String{paths.src} << " for changes"
+        << termcolor::reset << " (" << watch_failed.size() << " failing; Ctrl-C to stop)" << std::endl;
+    }
+    while(changed.empty() && !watch_interrupted) {
+      changed = watch.wait(std::nullopt);
+    }
+    if(watch_interrupted) break;
+
+    std::cout << "Changed: " << changed.front().string();
+    if(changed.size() > 1) {
+      std::cout << " and " << changed.size() - 1 << " more";
+    }
+    std::cout << std::endl << "Building " << paths.project << "..." << std::endl;
+    changed.clear();
+    String output;
+    built = make_build(paths, HARDWARE_CONCURRENCY, output);
+    if(!built) {
+      std::cerr << termcolor::red << output << termcolor::reset << std::endl;
+      std::cout << "The build failed; watching for changes." << std::endl;
+    }
+  }
+  return exit_code;
 }
 
-static Optional<String> get_raw_running_command(const String &full_name) {
-  using namespace std::string_literals;
-  std::ostringstream panic_msg;
-  const auto get_run_cmd_command = "make "s + full_name
-    + ".output --dry-run --silent --assume-old=os.dsk --what-if=os.dsk";
+// modes building other trees, or needing the terminal, run here
+static bool can_use_daemon(argparse::ArgumentParser &program) {
+  for(const auto *name : {"--daemon", "--watch", "--control", "--clean-build", "--just-run", "--gdb-run", "--ab", "--ab-rev",
+      "--bisect", "--batch", "--merge", "--worker"}) {
+    if(program.is_used(name)) return false;
+  }
+  if(program.is_used("--project")) {
+    const auto project = program.get<String>("--project");
+    return project != "all" && project.find(',') == String::npos;
+  }
+  return true;
+}
 
-  const auto get_run_cmd_result = exec_str(get_run_cmd_command.c_str());
-  if (get_run_cmd_result.first != 0 || !get_run_cmd_result.second) {
-    panic_msg << "Cannot find out the command line to run the case";
+// as main from the discovery on, in a child of the daemon
+static int serve_daemon_request(DaemonState &state, const Vector<String> &args, const Path &cwd) {
+  const std::chrono::system_clock::time_point pincheck_start = std::chrono::system_clock::now();
+  invocation_path = cwd;
+
+  std::cout << termcolor::reset;
+  std::cerr << termcolor::reset;
+
+  Vector<char*> argv;
+  for(const auto &arg : args) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+  argparse::ArgumentParser program("pincheck", PINCHECK_VERSION);
+  parse_args(program, static_cast<int>(argv.size()), argv.data());
+
+  Optional<TraceLog> trace;
+  if(program.is_used("--trace")) {
+    trace.emplace();
+  }
+  TraceLog *trace_ptr = trace ? &*trace : nullptr;
+  Optional<SelfProfile> profile;
+  if(program.get<bool>("--self-profile")) {
+    profile.emplace();
+  }
+  SelfProfile *profile_ptr = profile ? &*profile : nullptr;
+
+  const auto exit_code = run_tests(program, state.paths, filter_tests(state.catalog, parse_test_filter(program)),
+    *state.history, *state.kernel_stats, trace_ptr, profile_ptr);
+  return finish_run(program, trace_ptr, profile_ptr, pincheck_start, exit_code);
+}
+
+// "all", or project names separated by commas
+static Vector<String> parse_projects(const String &s) {
+  std::ostringstream panic_msg;
+  constexpr std::array<const char*, 4> all_proj = {"threads", "userprog", "vm", "filesys"};
+  if(s == "all") return {all_proj.cbegin(), all_proj.cend()};
+
+  Vector<String> ret;
+  std::istringstream is{s};
+  String project;
+  while(std::getline(is, project, ',')) {
+    if(std::find(all_proj.cbegin(), all_proj.cend(), project) == all_proj.cend()) {
+      panic_msg << "The detected or given project name is not thread, userprog, vm, nor filesys.\n";
+      panic_msg << "Please move path to any project directory or its build directory.";
+      panic(panic_msg);
+    }
+    if(std::find(ret.cbegin(), ret.cend(), project) == ret.cend()) ret.push_back(project);
+  }
+  if(ret.empty()) {
+    panic_msg << "No project given by -p.";
     panic(panic_msg);
   }
+  return ret;
+}
 
-  auto full_run_command = string_trim(*(get_run_cmd_result.second));
-  if(std::count(full_run_command.begin(), full_run_command.end(), '\n') >= 2) {
-    return std::nullopt;
+static auto get_target_test_or_panic(const String &t, const Vector<TestCase> &target_tests) {
+  std::ostringstream panic_msg;
+  auto it = std::find_if(target_tests.cbegin(), target_tests.cend(), [&t](const TestCase &here){
+    return t == here.name || t == here.full_name();
+  });
+  if(it == target_tests.cend()) {
+    panic_msg << "Cannot find the case named " << t;
+    panic(panic_msg);
   }
 
-  return full_run_command;
+  return it;
 }
 
 static String get_running_command(const String &full_name, bool gdb_opt, bool timeout_opt) {
   using namespace std::string_literals;
   std::ostringstream panic_msg;
 
-  auto optional_command = get_raw_running_command(full_name);
+  auto optional_command = get_raw_running_command(fs::current_path(), full_name);
   if(!optional_command) {
     panic_msg << "Cannot find out the command line to run the case";
     panic(panic_msg);
@@ -0,0 +1,633 @@
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <cstring>
+#include <unistd.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "remote_worker.h"
+#include "socket_helper.h"
+#include "test_discovery.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+constexpr char DEFAULT_WORKER_PORT[] = "7441";
+// a line longer than this is a broken peer
+constexpr size_t MAX_LINE = 1 << 16;
+// as are a file larger than this, and more files than this in one job;
+// disks and test programs are a few megabytes at most
+constexpr size_t MAX_FILE_SIZE = 256 << 20;
+constexpr size_t MAX_JOB_FILES = 256;
+
+Connection::Connection(int fd)
+: fd(fd), buffer() {}
+
+Connection::~Connection() noexcept {
+  if(fd >= 0) close(fd);
+}
+
+Pair<String, String> split_address(const String &address) {
+  const auto colon = address.rfind(':');
+  if(colon == String::npos) {
+    if(!address.empty() && std::all_of(address.cbegin(), address.cend(), ::isdigit)) return {"", address};
+    return {address, DEFAULT_WORKER_PORT};
+  }
+  const auto port = address.substr(colon + 1);
+  return {address.substr(0, colon), port.empty() ? DEFAULT_WORKER_PORT : port};
+}
+
+std::unique_ptr<Connection> Connection::connect(const String &address) {
+  const auto [host, port] = split_address(address);
+  addrinfo hints{}, *res = nullptr;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if(getaddrinfo(host.empty() ? "localhost" : host.c_str(), port.c_str(), &hints, &res) != 0) return nullptr;
+
+  int fd = -1;
+  for(auto *ai = res; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if(fd < 0) continue;
+    if(::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  if(fd < 0) return nullptr;
+
+  // requests are small and answered one by one
+  const int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return std::make_unique<Connection>(fd);
+}
+
+bool Connection::send(const String &bytes) {
+  return send_all(fd, bytes);
+}
+
+Optional<String> Connection::read_line() {
+  return ::read_line(fd, buffer, MAX_LINE);
+}
+
+Optional<String> Connection::read_bytes(size_t size) {
+  if(size > MAX_FILE_SIZE) return std::nullopt;
+  const auto buffered = std::min(size, buffer.size());
+  String ret = buffer.substr(0, buffered);
+  buffer.erase(0, buffered);
+  ret.resize(size);
+  for(size_t got = buffered; got < size; ) {
+    const auto r = recv(fd, ret.data() + got, size - got, 0);
+    if(r < 0 && errno == EINTR) continue;
+    if(r <= 0) return std::nullopt;
+    got += r;
+  }
+  return ret;
+}
+
+// SHA-256 of FIPS 180-4; blobs of one coordinator are trusted by others
+// with the same hash, so it must not be possible to make a collision
+static String sha256_hex(const String &bytes) {
+  static constexpr std::uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+  std::uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  const auto rotr = [](std::uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+
+  // padded with 0x80, zeros and the length in bits, to whole blocks
+  String message = bytes;
+  message += static_cast<char>(0x80);
+  while(message.size() % 64 != 56) message += '\0';
+  const std::uint64_t bits = static_cast<std::uint64_t>(bytes.size()) * 8;
+  for(int i = 7; i >= 0; --i) message += static_cast<char>(bits >> (i * 8));
+
+  for(size_t block = 0; block < message.size(); block += 64) {
+    std::uint32_t w[64];
+    for(int i = 0; i < 16; ++i) {
+      const auto *p = reinterpret_cast<const unsigned char*>(message.data() + block + i * 4);
+      w[i] = std::uint32_t{p[0]} << 24 | std::uint32_t{p[1]} << 16 | std::uint32_t{p[2]} << 8 | p[3];
+    }
+    for(int i = 16; i < 64; ++i) {
+      const auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      const auto s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    auto a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+    for(int i = 0; i < 64; ++i) {
+      const auto t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+      const auto t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      hh = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+  }
+
+  std::ostringstream os;
+  os << std::hex << std::setfill('0');
+  for(const auto x : h) os << std::setw(8) << x;
+  return os.str();
+}
+
+String content_hash(const String &bytes) {
+  return sha256_hex(bytes) + '-' + std::to_string(bytes.size());
+}
+
+static Optional<String> read_file(const Path &file) {
+  std::ifstream is{file, std::ios::binary};
+  if(!is.is_open()) return std::nullopt;
+  std::ostringstream os;
+  os << is.rdbuf();
+  return os.str();
+}
+
+// a relative path that stays inside the directory it is put in
+static bool is_safe_path(const String &p) {
+  const Path path{p};
+  if(p.empty() || path.is_absolute()) return false;
+  return std::none_of(path.begin(), path.end(), [](const Path &c){return c == "..";});
+}
+
+// as made by content_hash; it names a file in the cache
+static bool is_hash(const String &s) {
+  return !s.empty() && std::all_of(s.cbegin(), s.cend(), [](char c){return std::isxdigit(c) || c == '-';});
+}
+
+// split as the shell does, so that nothing it would interpret gets through
+bool is_launcher_command(const String &command) {
+  const String plain = "-_./:=,+@%";
+  struct Word {
+    String text;
+    bool quoted = false;    // a part of it was in single quotes
+    bool redirects = false; // it has an unquoted < or >
+  };
+  Vector<Word> words;
+  bool in_word = false;
+  for(size_t i = 0; i < command.size(); ++i) {
+    const char c = command[i];
+    if(c == ' ' || c == '\t') {
+      in_word = false;
+      continue;
+    }
+    if(!in_word) words.emplace_back();
+    in_word = true;
+    auto &word = words.back();
+    if(c == '\'') {
+      const auto end = command.find('\'', i + 1);
+      if(end == String::npos || command.find('\n', i) < end) return false;
+      word.text += command.substr(i + 1, end - i - 1);
+      word.quoted = true;
+      i = end;
+    } else if(c == '<' || c == '>') {
+      word.text += c;
+      word.redirects = true;
+    } else if(std::isalnum(static_cast<unsigned char>(c)) || plain.find(c) != String::npos) {
+      word.text += c;
+    } else {
+      return false;
+    }
+  }
+
+  // a redirection is a word of its own, and so is what it redirects to
+  const auto is_redirection = [](const Word &w) {
+    return !w.quoted && (w.text == "<" || w.text == ">" || w.text == "2>");
+  };
+  const auto is_plain_path = [](const Word &w) {
+    return !w.quoted && !w.redirects && is_safe_path(w.text);
+  };
+  if(words.empty() || words[0].quoted || words[0].redirects || words[0].text != "pintos") return false;
+  for(size_t i = 1; i < words.size(); ++i) {
+    const auto &word = words[i];
+    if(is_redirection(word)) {
+      if(i + 1 == words.size()) return false;
+      const auto &target = words[++i];
+      if(word.text == "<" ? target.quoted || target.redirects || target.text != "/dev/null" : !is_plain_path(target)) {
+        return false;
+      }
+    } else if(word.redirects) {
+      return false;
+    } else if(word.text.find('/') != String::npos && !is_safe_path(word.text)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// compares in a time that does not tell how much of the secret matched
+static bool same_secret(const String &a, const String &b) {
+  unsigned char diff = a.size() != b.size();
+  for(size_t i = 0; i < std::min(a.size(), b.size()); ++i) {
+    diff |= a[i] ^ b[i];
+  }
+  return diff == 0;
+}
+
+/** Worker */
+
+namespace {
+
+// counts the jobs running at once
+class SlotLimit {
+private:
+  std::mutex mut;
+  std::condition_variable cv;
+  unsigned free;
+
+public:
+  explicit SlotLimit(unsigned slots) : free(slots) {}
+  void acquire() {
+    std::unique_lock lock{mut};
+    cv.wait(lock, [this]{return free > 0;});
+    --free;
+  }
+  void release() {
+    {
+      std::unique_lock lock{mut};
+      ++free;
+    }
+    cv.notify_one();
+  }
+};
+
+}
+
+static std::atomic<unsigned long> scratch_id{0};
+
+static bool serve_run(Connection &conn, const Vector<String> &header, const Path &cache_dir, SlotLimit &limit) {
+  const auto inputs = std::stoul(header[1]), outputs = std::stoul(header[2]), cmd_size = std::stoul(header[3]);
+  if(inputs > MAX_JOB_FILES || outputs > MAX_JOB_FILES || cmd_size > MAX_LINE) return false;
+
+  Vector<Pair<String, String>> input_files;
+  for(size_t i = 0; i < inputs; ++i) {
+    const auto line = conn.read_line();
+    if(!line) return false;
+    const auto space = line->find(' ');
+    if(space == String::npos) return false;
+    input_files.emplace_back(line->substr(0, space), line->substr(space + 1));
+  }
+  Vector<String> output_files;
+  for(size_t i = 0; i < outputs; ++i) {
+    const auto line = conn.read_line();
+    if(!line) return false;
+    output_files.push_back(*line);
+  }
+  const auto command = conn.read_bytes(cmd_size);
+  if(!command) return false;
+  if(!is_launcher_command(*command)) return conn.send("ERR not a pintos command\n");
+
+  const auto dir = cache_dir / "jobs" / std::to_string(scratch_id++);
+  String error;
+  try {
+    for(const auto &[hash, path] : input_files) {
+      const auto blob = cache_dir / "blobs" / hash;
+      if(!is_safe_path(path) || !is_hash(hash)) {
+        error = "unsafe path " + path;
+      } else if(!fs::exists(blob)) {
+        error = "missing " + hash;
+      }
+      if(!error.empty()) break;
+      fs::create_directories((dir / path).parent_path());
+      // a copy; the command may write to its disks
+      fs::copy_file(blob, dir / path);
+    }
+    for(const auto &path : output_files) {
+      if(!is_safe_path(path)) error = "unsafe path " + path;
+      else fs::create_directories((dir / path).parent_path());
+    }
+  } catch(const fs::filesystem_error &e) {
+    error = e.what();
+  }
+  if(!error.empty()) {
+    fs::remove_all(dir);
+    return conn.send("ERR " + error + "\n");
+  }
+
+  limit.acquire();
+  ResourceUsage usage;
+  const auto shell = "cd " + shell_quote(dir) + " && " + *command;
+  const auto res = exec_str(shell.c_str(), usage);
+  limit.release();
+
+  std::ostringstream reply;
+  reply << "DONE " << res.first << ' ' << format_fixed(usage.user_sec, 3) << ' ' << format_fixed(usage.sys_sec, 3)
+    << ' ' << usage.max_rss_kb << ' ' << output_files.size() << '\n';
+  for(const auto &path : output_files) {
+    const auto bytes = read_file(dir / path).value_or("");
+    reply << path << ' ' << bytes.size() << '\n' << bytes;
+  }
+  fs::remove_all(dir);
+  return conn.send(reply.str());
+}
+
+static void serve_connection(std::unique_ptr<Connection> conn, unsigned slots, const Path &cache_dir,
+  const String &token, SlotLimit &limit) {
+  bool authenticated = false;
+  while(const auto line = conn->read_line()) {
+    const auto tokens = string_tokenize(*line);
+    if(tokens.empty()) continue;
+    const auto &verb = tokens[0];
+    bool ok = true;
+    try {
+      if(!authenticated) {
+        // nothing but HELLO with the token, and a peer without it is dropped
+        if(verb != "HELLO" || tokens.size() != 3 || !same_secret(tokens[2], token)) {
+          conn->send("ERR not authenticated\n");
+          break;
+        }
+        authenticated = true;
+        ok = conn->send("HELLO " + std::to_string(slots) + "\n");
+      } else if(verb == "HELLO") {
+        ok = conn->send("HELLO " + std::to_string(slots) + "\n");
+      } else if(verb == "HAVE" && tokens.size() == 2) {
+        ok = conn->send(is_hash(tokens[1]) && fs::exists(cache_dir / "blobs" / tokens[1]) ? "YES\n" : "NO\n");
+      } else if(verb == "PUT" && tokens.size() == 3 && is_hash(tokens[1])) {
+        const auto bytes = conn->read_bytes(std::stoul(tokens[2]));
+        if(!bytes) break;
+        if(content_hash(*bytes) != tokens[1]) {
+          ok = conn->send("ERR hash mismatch\n");
+        } else {
+          // written aside and renamed, as another connection may put it too
+          const auto blob = cache_dir / "blobs" / tokens[1];
+          const auto tmp = blob.string() + ".tmp" + std::to_string(scratch_id++);
+          std::ofstream{tmp, std::ios::binary} << *bytes;
+          fs::rename(tmp, blob);
+          ok = conn->send("OK\n");
+        }
+      } else if(verb == "RUN" && tokens.size() == 4) {
+        ok = serve_run(*conn, tokens, cache_dir, limit);
+      } else {
+        ok = conn->send("ERR unknown request\n");
+      }
+    } catch(const std::exception &e) {
+      ok = conn->send(String{"ERR "} + e.what() + "\n");
+    }
+    if(!ok) break;
+  }
+}
+
+int worker_serve(const String &address, unsigned slots, const Path &cache_dir, const String &token) {
+  std::ostringstream panic_msg;
+  const auto [host, port] = split_address(address);
+
+  try {
+    fs::create_directories(cache_dir / "blobs");
+    fs::remove_all(cache_dir / "jobs");
+    fs::create_directories(cache_dir / "jobs");
+  } catch(const fs::filesystem_error &e) {
+    panic_msg << "Cannot prepare the worker cache " << cache_dir << ": " << e.what();
+    panic(panic_msg);
+  }
+
+  addrinfo hints{}, *res = nullptr;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  // only this machine unless a host is given, as 0.0.0.0 for every interface
+  if(getaddrinfo(host.empty() ? "127.0.0.1" : host.c_str(), port.c_str(), &hints, &res) != 0) {
+    panic_msg << "Cannot resolve the address to listen on: " << address;
+    panic(panic_msg);
+  }
+  int fd = -1;
+  for(auto *ai = res; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if(fd < 0) continue;
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if(bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0) break;
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  if(fd < 0) {
+    panic_msg << "Cannot listen on " << address << ": " << std::strerror(errno);
+    panic(panic_msg);
+  }
+
+  std::cout << termcolor::bold << "Worker listening on " << (host.empty() ? "127.0.0.1" : host) << ":" << port
+    << termcolor::reset << " with " << slots << " slots, cache in " << String{cache_dir} << std::endl;
+
+  SlotLimit limit{slots};
+  while(true) {
+    sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    const int client = accept(fd, reinterpret_cast<sockaddr*>(&peer), &peer_len);
+    if(client < 0) {
+      if(errno == EINTR) continue;
+      panic_msg << "Cannot accept a connection: " << std::strerror(errno);
+      panic(panic_msg);
+    }
+    const int one = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    std::thread(serve_connection, std::make_unique<Connection>(client), slots, cache_dir, token, std::ref(limit)).detach();
+  }
+}
+
+/** Coordinator */
+
+Optional<String> HashCache::hash(const Path &file) {
+  std::error_code ec;
+  const auto size = fs::file_size(file, ec);
+  if(ec) return std::nullopt;
+  const auto mtime = fs::last_write_time(file, ec).time_since_epoch().count();
+  if(ec) return std::nullopt;
+  const auto key = String{file};
+  {
+    std::unique_lock lock{mut};
+    const auto it = entries.find(key);
+    if(it != entries.end() && it->second.first == Pair<uintmax_t, long long>{size, mtime}) return it->second.second;
+  }
+  const auto bytes = read_file(file);
+  if(!bytes) return std::nullopt;
+  auto hash = content_hash(*bytes);
+  std::unique_lock lock{mut};
+  entries[key] = {{size, mtime}, hash};
+  return hash;
+}
+
+RemoteSlot::RemoteSlot(RemoteHost &host, std::unique_ptr<Connection> conn, HashCache &hashes)
+: host(host), conn(std::move(conn)), hashes(hashes), lost() {}
+
+const String &RemoteSlot::lost_reason() const {
+  return lost;
+}
+
+// the files the command reads and those it redirects to, relative to the build
+static Pair<Vector<String>, Vector<String>> command_files(const String &command) {
+  Vector<String> inputs{"os.dsk"}, outputs;
+  const auto tokens = string_tokenize(command);
+  for(size_t i = 0; i + 1 < tokens.size(); ++i) {
+    if(tokens[i] == "-p") {
+      inputs.push_back(tokens[i + 1].substr(0, tokens[i + 1].find(':')));
+    } else if(tokens[i] == ">" || tokens[i] == "2>") {
+      outputs.push_back(tokens[i + 1]);
+    }
+  }
+  return {inputs, outputs};
+}
+
+Optional<String> RemoteSlot::upload(const Path &file, bool &broken) {
+  broken = false;
+  const auto connection_lost = [&broken]() -> Optional<String> {
+    broken = true;
+    return std::nullopt;
+  };
+  const auto hash = hashes.hash(file);
+  if(!hash) return std::nullopt;
+  {
+    std::unique_lock lock{host.mut};
+    if(host.known.count(*hash)) return hash;
+  }
+  if(!conn->send("HAVE " + *hash + "\n")) return connection_lost();
+  const auto have = conn->read_line();
+  if(!have) return connection_lost();
+  if(*have != "YES") {
+    const auto bytes = read_file(file);
+    // changed since it was hashed
+    if(!bytes || content_hash(*bytes) != *hash) return std::nullopt;
+    if(!conn->send("PUT " + *hash + " " + std::to_string(bytes->size()) + "\n" + *bytes)) return connection_lost();
+    const auto reply = conn->read_line();
+    if(!reply) return connection_lost();
+    if(*reply != "OK") return std::nullopt;
+  }
+  std::unique_lock lock{host.mut};
+  host.known.insert(*hash);
+  return hash;
+}
+
+bool RemoteSlot::is_lost() const {
+  return !lost.empty();
+}
+
+Optional<int> RemoteSlot::run_output(const TestPath &paths, const TestCase &testcase, ResourceUsage &usage) {
+  if(!lost.empty()) return std::nullopt;
+  Optional<String> command;
+  try {
+    PanicScope panic_scope;
+    command = get_raw_running_command(paths.build, testcase.full_name());
+  } catch(const PanicError &) {
+    // make fails the same way when the test runs here
+    return std::nullopt;
+  }
+  // the worker would refuse it
+  if(!command || command->size() > MAX_LINE || !is_launcher_command(*command)) return std::nullopt;
+  auto [inputs, outputs] = command_files(*command);
+  if(fs::exists(paths.build / "kernel.bin")) inputs.push_back("kernel.bin");
+
+  // the connection is out of step or gone; an ERR reply is of this job only
+  const auto fail = [&](const String &why) -> Optional<int> {
+    lost = why;
+    return std::nullopt;
+  };
+
+  std::ostringstream request;
+  request << "RUN " << inputs.size() << ' ' << outputs.size() << ' ' << command->size() << '\n';
+  if(inputs.size() > MAX_JOB_FILES || outputs.size() > MAX_JOB_FILES) return std::nullopt;
+  for(const auto &input : inputs) {
+    std::error_code ec;
+    if(!is_safe_path(input) || fs::file_size(paths.build / input, ec) > MAX_FILE_SIZE) return std::nullopt;
+    bool broken;
+    const auto hash = upload(paths.build / input, broken);
+    if(broken) return fail("connection lost");
+    if(!hash) return std::nullopt;
+    request << *hash << ' ' << input << '\n';
+  }
+  for(const auto &output : outputs) {
+    if(!is_safe_path(output)) return std::nullopt;
+    request << output << '\n';
+  }
+  request << *command;
+  if(!conn->send(request.str())) return fail("connection lost");
+
+  const auto reply = conn->read_line();
+  if(!reply) return fail("connection lost");
+  const auto tokens = string_tokenize(*reply);
+  if(!tokens.empty() && tokens[0] == "ERR") return std::nullopt;
+  if(tokens.size() != 6 || tokens[0] != "DONE") return fail("bad reply " + *reply);
+
+  try {
+    const int exit_code = std::stoi(tokens[1]);
+    usage.user_sec = std::stod(tokens[2]);
+    usage.sys_sec = std::stod(tokens[3]);
+    usage.max_rss_kb = std::stol(tokens[4]);
+    for(size_t i = 0, n = std::stoul(tokens[5]); i < n; ++i) {
+      const auto header = conn->read_line();
+      if(!header) return fail("connection lost");
+      const auto space = header->rfind(' ');
+      if(space == String::npos) return fail("bad reply " + *header);
+      const auto path = header->substr(0, space);
+      const auto bytes = conn->read_bytes(std::stoul(header->substr(space + 1)));
+      if(!bytes) return fail("connection lost");
+      if(std::find(outputs.cbegin(), outputs.cend(), path) == outputs.cend()) return fail("unexpected " + path);
+      std::ofstream{paths.build / path, std::ios::binary} << *bytes;
+    }
+    return exit_code;
+  } catch(const std::logic_error &) {
+    return fail("bad reply " + *reply);
+  }
+}
+
+RemotePool::RemotePool(const Vector<String> &addresses, const String &token) {
+  std::ostringstream panic_msg;
+  // each connection is authenticated by itself; the first tells the slots
+  const auto hello = [&](const String &address, unsigned &worker_slots) {
+    auto conn = Connection::connect(address);
+    if(!conn || !conn->send(String{"HELLO "} + PINCHECK_VERSION + " " + token + "\n")) {
+      panic_msg << "Cannot connect to the worker " << address;
+      panic(panic_msg);
+    }
+    const auto reply = conn->read_line();
+    const auto tokens = reply ? string_tokenize(*reply) : Vector<String>{};
+    if(!tokens.empty() && tokens[0] == "ERR") {
+      panic_msg << "The worker " << address << " refused the --worker-token";
+      panic(panic_msg);
+    }
+    if(tokens.size() != 2 || tokens[0] != "HELLO") {
+      panic_msg << "The worker " << address << " does not speak the protocol";
+      panic(panic_msg);
+    }
+    worker_slots = std::max(1, std::stoi(tokens[1]));
+    return conn;
+  };
+
+  for(const auto &address : addresses) {
+    auto host = std::make_unique<RemoteHost>();
+    host->address = address;
+    auto first = hello(address, host->slots);
+    slots.push_back(std::make_unique<RemoteSlot>(*host, std::move(first), hashes));
+    for(unsigned i = 1, n = host->slots; i < n; ++i) {
+      unsigned ignored;
+      slots.push_back(std::make_unique<RemoteSlot>(*host, hello(address, ignored), hashes));
+    }
+    hosts.push_back(std::move(host));
+  }
+}
+
+size_t RemotePool::size() const {
+  return slots.size();
+}
+
+RemoteSlot *RemotePool::slot(size_t i) {
+  return slots[i].get();
+}
+
+void RemotePool::print(std::ostream &os) const {
+  for(const auto &host : hosts) {
+    os << "Worker " << host->address << ": " << host->slots << " slots";
+    for(const auto &slot : slots) {
+      if(&slot->host == host.get() && !slot->lost.empty()) {
+        os << termcolor::yellow << " (lost: " << slot->lost << "; not used since)" << termcolor::reset;
+        break;
+      }
+    }
+    os << std::endl;
+  }
+}
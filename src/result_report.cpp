@@ -0,0 +1,172 @@
+#include <stdexcept>
+
+#include "execution.h"
+#include "result_report.h"
+#include "string_helper.h"
+
+// a reason longer than this is cut in JUnit; the full dump is in the .result
+constexpr size_t JUNIT_REASON_LIMIT = 4096;
+
+static long long to_unix_ms(std::chrono::system_clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count();
+}
+
+JsonReport::JsonReport(const Path &file)
+: fs(file) {
+  std::ostringstream panic_msg;
+  if(!fs.is_open()) {
+    panic_msg << "Cannot open the JSON report file " << file;
+    panic(panic_msg);
+  }
+}
+
+void JsonReport::write(const TestResult &r, unsigned epoch) {
+  std::ostringstream os;
+  os << "{\"name\":\"" << json_escape(r.testcase.name) << '"'
+    << ",\"subdir\":\"" << json_escape(r.testcase.subdir) << '"'
+    << ",\"subtitle\":\"" << json_escape(r.testcase.subtitle) << '"'
+    << ",\"points\":" << r.testcase.max_ptr
+    << ",\"epoch\":" << epoch
+    << ",\"passed\":" << (r.passed ? "true" : "false")
+    << ",\"status\":\"" << r.status() << '"'
+    << ",\"exit_code\":" << r.exit_code
+    << ",\"start\":" << to_unix_ms(r.start_time)
+    << ",\"end\":" << to_unix_ms(r.end_time)
+    << ",\"duration\":" << format_fixed(r.duration_sec(), 3)
+    << ",\"reason\":\"" << json_escape(r.reason()) << '"'
+    << ",\"phases\":{\"run\":" << format_fixed(r.run_sec, 3)
+    << ",\"check\":" << format_fixed(r.check_sec, 3)
+    << ",\"overhead\":" << format_fixed(r.overhead_sec(), 3) << '}'
+    << ",\"usage\":{\"user\":" << format_fixed(r.usage.user_sec, 3)
+    << ",\"sys\":" << format_fixed(r.usage.sys_sec, 3)
+    << ",\"max_rss_kb\":" << r.usage.max_rss_kb
+    << ",\"nvcsw\":" << r.usage.nvcsw
+    << ",\"nivcsw\":" << r.usage.nivcsw
+    << ",\"inblock\":" << r.usage.inblock
+    << ",\"oublock\":" << r.usage.oublock << '}';
+  if(!r.kernel.empty()) {
+    const char *sep = "";
+    os << ",\"kernel\":{";
+    for(const auto &[name, value] : r.kernel.counters) {
+      os << sep << '"' << json_escape(name) << "\":" << value;
+      sep = ",";
+    }
+    os << '}';
+  }
+  if(r.kernel_prev) {
+    const char *sep = "";
+    os << ",\"kernel_delta\":{";
+    for(const auto &[name, value] : r.kernel.counters) {
+      const auto prev = r.kernel_prev->get(name);
+      if(!prev) continue;
+      os << sep << '"' << json_escape(name) << "\":" << (value - *prev);
+      sep = ",";
+    }
+    os << '}';
+  }
+  os << "}\n";
+  fs << os.str() << std::flush;
+}
+
+Optional<String> json_field(const String &line, const String &key) {
+  const auto pattern = '"' + key + "\":";
+  // nested objects come after the top-level scalars of JsonReport::write
+  auto pos = line.find(pattern);
+  if(pos == String::npos) return std::nullopt;
+  pos += pattern.size();
+
+  String ret;
+  if(pos < line.size() && line[pos] == '"') {
+    for(++pos; pos < line.size() && line[pos] != '"'; ++pos) {
+      if(line[pos] != '\\' || pos + 1 >= line.size()) {
+        ret += line[pos];
+        continue;
+      }
+      switch(line[++pos]) {
+        case 'n': ret += '\n'; break;
+        case 't': ret += '\t'; break;
+        case 'r': ret += '\r'; break;
+        case 'u':
+          if(pos + 4 < line.size()) {
+            // a line cut short or mangled is skipped as one without the key
+            try {
+              ret += static_cast<char>(std::stoi(line.substr(pos + 1, 4), nullptr, 16));
+            } catch(const std::logic_error &) {
+              return std::nullopt;
+            }
+            pos += 4;
+          }
+          break;
+        default: ret += line[pos];
+      }
+    }
+    return ret;
+  }
+  const auto end = line.find_first_of(",}", pos);
+  return line.substr(pos, end == String::npos ? String::npos : end - pos);
+}
+
+JunitReport::JunitReport(const Path &file)
+: fs(file), entries()
+, suite_start(std::chrono::system_clock::now())
+, suites_end() {
+  std::ostringstream panic_msg;
+  if(!fs.is_open()) {
+    panic_msg << "Cannot open the JUnit report file " << file;
+    panic(panic_msg);
+  }
+  fs << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n";
+  close_document();
+}
+
+// the closing tag is written after every suite and overwritten by the
+// next, so an exit at any point leaves valid XML
+void JunitReport::close_document() {
+  suites_end = fs.tellp();
+  fs << "</testsuites>\n" << std::flush;
+}
+
+void JunitReport::add(const TestResult &r) {
+  auto reason = r.reason();
+  if(reason.size() > JUNIT_REASON_LIMIT) {
+    reason.resize(JUNIT_REASON_LIMIT);
+    reason += "\n...";
+  }
+  entries.push_back(Entry{
+    r.testcase.subdir, r.testcase.name, r.duration_sec(), r.status(), std::move(reason)
+  });
+}
+
+void JunitReport::end_epoch(const String &suite_name) {
+  size_t failures = 0, errors = 0;
+  double total_sec = 0;
+  for(const auto &e : entries) {
+    if(e.status == "fail") ++failures;
+    else if(e.status == "error") ++errors;
+    total_sec += e.sec;
+  }
+
+  const auto now = std::chrono::system_clock::now();
+  std::ostringstream os;
+  os << "  <testsuite name=\"" << xml_escape(suite_name) << "\" tests=\"" << entries.size()
+    << "\" failures=\"" << failures << "\" errors=\"" << errors
+    << "\" time=\"" << format_fixed(std::chrono::duration<double>(now - suite_start).count(), 3) << "\">\n";
+  for(const auto &e : entries) {
+    os << "    <testcase classname=\"" << xml_escape(e.classname) << "\" name=\"" << xml_escape(e.name)
+      << "\" time=\"" << format_fixed(e.sec, 3) << "\"";
+    if(e.status == "pass") {
+      os << "/>\n";
+      continue;
+    }
+    const auto tag = e.status == "fail" ? "failure" : "error";
+    os << ">\n      <" << tag << " message=\"" << tag << "\">" << xml_escape(e.reason) << "</" << tag << ">\n"
+      << "    </testcase>\n";
+  }
+  os << "  </testsuite>\n";
+  fs.seekp(suites_end);
+  fs << os.str();
+  close_document();
+
+  entries.clear();
+  suite_start = now;
+}
@@ -6,7 +6,7 @@
 #include "execution.h"
 #include "string_helper.h"
 
-Vector<Rubric> parse_rubric(const Path& grading_file, Vector<TestCase> &target_tests, Vector<TestCase> &persistence_tests) {
+Vector<Rubric> parse_rubric(const Path& grading_file, const Path &src, Vector<TestCase> &target_tests, Vector<TestCase> &persistence_tests) {
   using namespace std::string_literals;
   std::ostringstream panic_msg;
 
@@ -56,7 +56,7 @@ Vector<Rubric> parse_rubric(const Path& grading_file, Vector<TestCase> &target_t
       rubric.subdir_suffix = tokens[1].substr(last_comma+1);
     }
     rubric.subdir = rubric_file.parent_path();
-    rubric_file = Path{"../.."} / rubric_file;
+    rubric_file = src / rubric_file;
 
     std::ifstream rubric_if(rubric_file);
     if(!rubric_if.is_open()) {
@@ -101,6 +101,7 @@ Vector<Rubric> parse_rubric(const Path& grading_file, Vector<TestCase> &target_t
           if(rubric.subtitles.count(curr_subtitle) == 0)
             rubric.subtitles[curr_subtitle] = {};
           rubric.subtitles[curr_subtitle].emplace_back(target->full_name());
+          rubric.points[target->full_name()] = std::stoi(first_token);
           target->max_ptr = std::stoi(first_token);
           target->subtitle = curr_subtitle;
         }
@@ -113,4 +114,14 @@ Vector<Rubric> parse_rubric(const Path& grading_file, Vector<TestCase> &target_t
 
   return rubrics;
 
+}
+
+double rubric_score(const Rubric &rubric, const std::unordered_set<String> &passed) {
+  const auto suffix = rubric.subdir_suffix == "persistence" ? "-persistence" : "";
+  unsigned earned = 0, possible = 0;
+  for(const auto &[name, points] : rubric.points) {
+    possible += points;
+    if(passed.count(name + suffix)) earned += points;
+  }
+  return possible == 0 ? 0 : rubric.max_pct * earned / possible;
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include <fstream>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "run_metrics.h"
+#include "execution.h"
+#include "string_helper.h"
+
+constexpr auto METRICS_WRITE_INTERVAL = std::chrono::seconds(1);
+constexpr int METRICS_POLL_MS = 200;
+
+RunMetrics::Histogram::Histogram(Vector<double> bounds)
+: bounds(std::move(bounds)), counts(this->bounds.size() + 1), sum(0), count(0) {}
+
+void RunMetrics::Histogram::observe(double value) {
+  const auto it = std::lower_bound(bounds.cbegin(), bounds.cend(), value);
+  ++counts[it - bounds.cbegin()];
+  sum += value;
+  ++count;
+}
+
+RunMetrics::RunMetrics(Optional<Path> file, Optional<unsigned> port)
+: mut()
+, started(0), passed(0), failed(0), timed_out(0)
+, duration({0.5, 1, 2, 5, 10, 20, 30, 60, 120, 300})
+, spawn_latency({0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1})
+, dispatch_latency({0.01, 0.05, 0.1, 0.2, 0.5, 1, 5})
+, last_duration()
+, busy_sec(0), discovery_sec(0)
+, slots(0), busy(0), queued(0)
+, dispatch_time(), last_end(), first_dispatch()
+, file(std::move(file)), last_write()
+, listen_fd(-1), stopping(false), server() {
+  std::ostringstream panic_msg;
+  if(!port) return;
+
+  listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  const int one = 1;
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<uint16_t>(*port));
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(listen_fd < 0
+    || setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0
+    || bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+    || listen(listen_fd, 8) != 0) {
+    panic_msg << "Cannot serve metrics on 127.0.0.1:" << *port << ": " << std::strerror(errno);
+    panic(panic_msg);
+  }
+  server = std::thread(&RunMetrics::serve, this);
+}
+
+RunMetrics::~RunMetrics() noexcept {
+  stopping = true;
+  if(server.joinable()) server.join();
+  if(listen_fd >= 0) close(listen_fd);
+}
+
+// any request gets the metrics; scrapers only ask for /metrics
+void RunMetrics::serve() {
+  while(!stopping) {
+    pollfd pfd{listen_fd, POLLIN, 0};
+    if(poll(&pfd, 1, METRICS_POLL_MS) <= 0) continue;
+    const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if(fd < 0) continue;
+
+    // the request head, up to the blank line or a short wait
+    String request;
+    Buffer chunk;
+    pollfd cfd{fd, POLLIN, 0};
+    while(request.find("\r\n\r\n") == String::npos && request.size() < chunk.size() * 8
+      && poll(&cfd, 1, METRICS_POLL_MS) > 0) {
+      const auto r = recv(fd, chunk.data(), chunk.size(), 0);
+      if(r <= 0) break;
+      request.append(chunk.data(), r);
+    }
+
+    const auto body = render();
+    std::ostringstream os;
+    os << "HTTP/1.0 200 OK\r\n"
+      << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+      << "Content-Length: " << body.size() << "\r\n"
+      << "Connection: close\r\n\r\n" << body;
+    const auto response = os.str();
+    size_t done = 0;
+    while(done < response.size()) {
+      const auto r = send(fd, response.data() + done, response.size() - done, MSG_NOSIGNAL);
+      if(r <= 0) break;
+      done += r;
+    }
+    close(fd);
+  }
+}
+
+void RunMetrics::discovery(double sec) {
+  std::unique_lock lock{mut};
+  discovery_sec = sec;
+}
+
+void RunMetrics::dispatched(size_t slot) {
+  std::unique_lock lock{mut};
+  const auto now = std::chrono::system_clock::now();
+  if(dispatch_time.size() <= slot) {
+    dispatch_time.resize(slot + 1);
+    last_end.resize(slot + 1);
+  }
+  dispatch_time[slot] = now;
+  if(!first_dispatch) first_dispatch = now;
+  ++started;
+}
+
+// pintos prints TIMEOUT when it kills the kernel, by TIMEOUT seconds of CPU time
+static bool is_timeout(const TestResult &r) {
+  return !r.passed && (r.dump.find("TIMEOUT") != String::npos
+    || (r.testcase.timeout > 0 && r.duration_sec() >= r.testcase.timeout));
+}
+
+void RunMetrics::finished(size_t slot, const Vector<TestResult> &results) {
+  std::unique_lock lock{mut};
+  if(results.empty() || slot >= dispatch_time.size()) return;
+  const auto &first = results.front();
+  const auto seconds = [](TimePoint from, TimePoint to) {
+    return std::max(0.0, std::chrono::duration<double>(to - from).count());
+  };
+
+  spawn_latency.observe(seconds(dispatch_time[slot], first.start_time));
+  if(last_end[slot]) {
+    dispatch_latency.observe(seconds(*last_end[slot], first.start_time));
+  }
+  last_end[slot] = first.end_time;
+  busy_sec += first.duration_sec();
+
+  for(const auto &r : results) {
+    r.passed ? ++passed : ++failed;
+    if(is_timeout(r)) ++timed_out;
+    duration.observe(r.duration_sec());
+    last_duration[r.testcase.full_name()] = r.duration_sec();
+  }
+}
+
+void RunMetrics::pool(size_t slots, size_t busy, size_t queued) {
+  std::unique_lock lock{mut};
+  this->slots = slots;
+  this->busy = busy;
+  this->queued = queued;
+}
+
+static String label_escape(const String &s) {
+  String ret;
+  for(const char c : s) {
+    if(c == '\\' || c == '"') ret += '\\';
+    if(c == '\n') {
+      ret += "\\n";
+      continue;
+    }
+    ret += c;
+  }
+  return ret;
+}
+
+String RunMetrics::render() const {
+  std::unique_lock lock{mut};
+  std::ostringstream os;
+  const auto head = [&os](const char *name, const char *type, const char *help) {
+    os << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+  };
+  const auto histogram = [&](const char *name, const char *help, const Histogram &h) {
+    head(name, "histogram", help);
+    unsigned long cumulative = 0;
+    for(size_t i = 0; i < h.bounds.size(); ++i) {
+      cumulative += h.counts[i];
+      os << name << "_bucket{le=\"" << h.bounds[i] << "\"} " << cumulative << '\n';
+    }
+    os << name << "_bucket{le=\"+Inf\"} " << h.count << '\n'
+      << name << "_sum " << format_fixed(h.sum, 3) << '\n'
+      << name << "_count " << h.count << '\n';
+  };
+
+  head("pincheck_tests_started_total", "counter", "Tests put into a slot; a persistence pair is one.");
+  os << "pincheck_tests_started_total " << started << '\n';
+  head("pincheck_tests_passed_total", "counter", "Passed test results.");
+  os << "pincheck_tests_passed_total " << passed << '\n';
+  head("pincheck_tests_failed_total", "counter", "Failed test results, timed out ones included.");
+  os << "pincheck_tests_failed_total " << failed << '\n';
+  head("pincheck_tests_timed_out_total", "counter", "Failed test results that reached their TIMEOUT.");
+  os << "pincheck_tests_timed_out_total " << timed_out << '\n';
+
+  histogram("pincheck_test_duration_seconds", "Wall time of each test result.", duration);
+  head("pincheck_test_last_duration_seconds", "gauge", "Wall time of the last result of each test.");
+  for(const auto &[name, sec] : last_duration) {
+    os << "pincheck_test_last_duration_seconds{test=\"" << label_escape(name) << "\"} " << format_fixed(sec, 3) << '\n';
+  }
+
+  head("pincheck_slots", "gauge", "Slots of the pool.");
+  os << "pincheck_slots " << slots << '\n';
+  head("pincheck_slots_busy", "gauge", "Slots running a test.");
+  os << "pincheck_slots_busy " << busy << '\n';
+  head("pincheck_queue_depth", "gauge", "Tests waiting for a slot.");
+  os << "pincheck_queue_depth " << queued << '\n';
+  head("pincheck_slot_busy_seconds_total", "counter", "Wall time slots spent running tests.");
+  os << "pincheck_slot_busy_seconds_total " << format_fixed(busy_sec, 3) << '\n';
+  double utilization = 0;
+  if(first_dispatch && slots > 0) {
+    const auto elapsed = std::chrono::duration<double>(std::chrono::system_clock::now() - *first_dispatch).count();
+    if(elapsed > 0) utilization = std::min(1.0, busy_sec / (elapsed * slots));
+  }
+  head("pincheck_slot_utilization", "gauge", "Busy share of the slots since the first dispatch, finished tests only.");
+  os << "pincheck_slot_utilization " << format_fixed(utilization, 4) << '\n';
+
+  histogram("pincheck_spawn_latency_seconds", "From putting a test into a slot to its start.", spawn_latency);
+  histogram("pincheck_dispatch_latency_seconds", "From the end of a test to the start of the next one in the slot.", dispatch_latency);
+  head("pincheck_discovery_seconds", "gauge", "Wall time of the last test discovery.");
+  os << "pincheck_discovery_seconds " << format_fixed(discovery_sec, 3) << '\n';
+  return os.str();
+}
+
+void RunMetrics::flush(bool force) {
+  if(!file) return;
+  const auto now = std::chrono::steady_clock::now();
+  if(!force && now - last_write < METRICS_WRITE_INTERVAL) return;
+  last_write = now;
+
+  // renamed into place, so a collector never reads half a file
+  const auto tmp = Path{String{*file} + ".tmp"};
+  {
+    std::ofstream fs{tmp};
+    if(!fs.is_open()) return;
+    fs << render();
+  }
+  std::error_code ec;
+  fs::rename(tmp, *file, ec);
+}
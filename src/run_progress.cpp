@@ -0,0 +1,87 @@
+#include "run_progress.h"
+
+// a test is overdue after this ratio of its recorded duration
+constexpr double OVERDUE_RATIO = 3;
+// ... and this many seconds beyond it, not to flag short tests on jitter
+constexpr double OVERDUE_MIN_SEC = 10;
+
+RunProgress::RunProgress(const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests,
+  const TestHistory *history, size_t pool_size)
+: expected(), pool_size(std::max<size_t>(1, pool_size))
+, has_history(history && history->size() > 0)
+, total_sec(0), done_sec(0)
+, start_time(std::chrono::system_clock::now()) {
+  for(const auto *tests : {&target_tests, &persistence_tests}) {
+    for(const auto &t : *tests) {
+      Expectation e{1, false};
+      if(has_history) {
+        e.sec = history->estimate_sec(t);
+        e.recorded = history->find(t.full_name()) != nullptr;
+      }
+      total_sec += e.sec;
+      expected.emplace(t.full_name(), e);
+    }
+  }
+}
+
+const RunProgress::Expectation &RunProgress::expectation(const TestCase &testcase) const {
+  static const Expectation unknown{1, false};
+  const auto it = expected.find(testcase.full_name());
+  return it == expected.end() ? unknown : it->second;
+}
+
+Optional<double> RunProgress::expected_sec(const TestCase &testcase) const {
+  const auto &e = expectation(testcase);
+  if(!e.recorded) return std::nullopt;
+  return e.sec;
+}
+
+bool RunProgress::overdue(const TestCase &testcase, double elapsed_sec) const {
+  const auto sec = expected_sec(testcase);
+  return sec && elapsed_sec > *sec * OVERDUE_RATIO && elapsed_sec > *sec + OVERDUE_MIN_SEC;
+}
+
+void RunProgress::finish(const TestCase &testcase) {
+  done_sec += expectation(testcase).sec;
+}
+
+double RunProgress::running_done_sec(const Vector<std::unique_ptr<TestRunner>> &pool) const {
+  if(!has_history) return 0;
+  double sec = 0;
+  for(const auto &p : pool) {
+    if(!p) continue;
+    // a runner beyond its expectation is counted as almost done, not more
+    sec += std::min(p->get_elapsed_sec(), 0.95 * expectation(p->get_test_case()).sec);
+  }
+  return sec;
+}
+
+double RunProgress::fraction(const Vector<std::unique_ptr<TestRunner>> &pool) const {
+  if(total_sec <= 0) return 1;
+  return std::min(1.0, (done_sec + running_done_sec(pool)) / total_sec);
+}
+
+Optional<std::chrono::seconds> RunProgress::eta(const Vector<std::unique_ptr<TestRunner>> &pool) const {
+  const auto f = fraction(pool);
+  if(f >= 1) return std::chrono::seconds(0);
+
+  double sec;
+  if(has_history) {
+    // the queued work shared by the slots, but no sooner than the longest
+    // running one; an overdue one may last until its TIMEOUT
+    double longest = 0;
+    for(const auto &p : pool) {
+      if(!p) continue;
+      const auto &testcase = p->get_test_case();
+      const auto elapsed = p->get_elapsed_sec();
+      const auto until = overdue(testcase, elapsed) ? testcase.timeout : expectation(testcase).sec;
+      longest = std::max(longest, until - elapsed);
+    }
+    sec = std::max(longest, (total_sec - done_sec - running_done_sec(pool)) / pool_size);
+  } else {
+    if(f <= 0) return std::nullopt;
+    const auto elapsed = std::chrono::duration<double>(std::chrono::system_clock::now() - start_time).count();
+    sec = elapsed * (1 - f) / f;
+  }
+  return std::chrono::seconds(static_cast<long>(std::max(0.0, sec) + 0.5));
+}
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+#include "run_simulator.h"
+#include "check_runner.h"
+#include "execution.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+// a run within this ratio of the best makespan is good enough
+constexpr double RECOMMEND_SLACK = 1.05;
+
+SimulationResult simulate_run(Vector<TestCase> target_tests, const Vector<TestCase> &persistence_tests,
+  const TestHistory &history, unsigned jobs, TestOrder order) {
+  const double poll_sec = std::chrono::duration<double>(CHECK_POLL_INTERVAL).count();
+  // only the CPU share of a test slows down when jobs outnumber cores
+  const double contention = std::max(1.0, static_cast<double>(jobs) / std::max(1u, HARDWARE_CONCURRENCY));
+
+  order_tests(target_tests, order, &history);
+  TestQueue queue(target_tests, persistence_tests);
+
+  struct Slot {
+    double end;
+    bool persistence;
+  };
+  Vector<Optional<Slot>> slots(jobs);
+
+  double now = 0, busy = 0;
+  while(true) {
+    bool persistence_running = std::any_of(slots.cbegin(), slots.cend(),
+      [](const Optional<Slot> &s){return s && s->persistence;});
+    for(auto &slot : slots) {
+      if(slot || queue.empty()) continue;
+      const auto testcase = queue.pop(persistence_running);
+      if(!testcase) break;
+      const auto share = history.cpu_share(*testcase);
+      const auto sec = history.estimate_sec(*testcase) * (1 - share + share * contention);
+      slot = Slot{now + sec, testcase->persistence};
+      busy += sec;
+      persistence_running = persistence_running || testcase->persistence;
+    }
+
+    double next_end = -1;
+    for(const auto &slot : slots) {
+      if(slot && (next_end < 0 || slot->end < next_end)) next_end = slot->end;
+    }
+    if(next_end < 0) break;
+
+    for(auto &slot : slots) {
+      if(slot && slot->end <= next_end) slot.reset();
+    }
+    // the main loop notices a finished runner on its next poll
+    now = queue.empty() ? next_end : std::ceil(next_end / poll_sec) * poll_sec;
+  }
+
+  return SimulationResult{jobs, order, now, busy, now > 0 ? busy / (now * jobs) : 0};
+}
+
+int simulate(const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests,
+  const TestHistory &history, unsigned max_jobs) {
+  constexpr std::array<TestOrder, 3> orders = {TestOrder::make, TestOrder::timeout, TestOrder::history};
+
+  std::cout << termcolor::bold << "\n-- Simulated makespan (sec) --" << termcolor::reset << std::endl;
+  if(history.size() == 0) {
+    std::cout << termcolor::yellow << "No recorded durations yet; TIMEOUT is used as the duration of each test."
+      << termcolor::reset << std::endl;
+  }
+
+  std::cout << std::setw(6) << "jobs";
+  for(const auto order : orders) {
+    std::cout << std::setw(10) << test_order_name(order);
+  }
+  std::cout << std::setw(12) << "util." << std::endl;
+
+  Optional<SimulationResult> best;
+  Vector<SimulationResult> best_per_jobs;
+  for(unsigned jobs = 1; jobs <= max_jobs; ++jobs) {
+    std::cout << std::setw(6) << jobs;
+    Optional<SimulationResult> here;
+    for(const auto order : orders) {
+      const auto res = simulate_run(target_tests, persistence_tests, history, jobs, order);
+      std::cout << std::setw(10) << format_fixed(res.makespan_sec, 1);
+      if(!here || res.makespan_sec < here->makespan_sec) here = res;
+    }
+    std::cout << std::setw(11) << format_fixed(100 * here->utilization, 1) << "%" << std::endl;
+
+    best_per_jobs.push_back(*here);
+    if(!best || here->makespan_sec < best->makespan_sec) best = here;
+  }
+  if(!best) return 1;
+
+  // the fewest jobs close enough to the best; more jobs risk spurious timeouts
+  const auto recommended = *std::find_if(best_per_jobs.cbegin(), best_per_jobs.cend(),
+    [&best](const SimulationResult &r){return r.makespan_sec <= best->makespan_sec * RECOMMEND_SLACK;});
+
+  std::cout << std::endl << termcolor::bold << "Recommended: -j " << recommended.jobs
+    << " --order " << test_order_name(recommended.order) << termcolor::reset
+    << " (predicted " << format_fixed(recommended.makespan_sec, 1) << " sec, "
+    << format_fixed(100 * recommended.utilization, 1) << "% utilization)" << std::endl;
+  std::cout << termcolor::bright_grey << "Hardware concurrency: " << HARDWARE_CONCURRENCY
+    << "; above that, the CPU share of each test is stretched by jobs/cores." << termcolor::reset << std::endl;
+  return 0;
+}
@@ -0,0 +1,89 @@
+#include <iomanip>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "self_profile.h"
+#include "execution.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+static thread_local unsigned scope_depth = 0;
+
+static double thread_cpu_sec() {
+  struct timespec ts;
+  if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double rusage_cpu_sec(int who) {
+  struct rusage ru;
+  if(getrusage(who, &ru) != 0) return 0;
+  return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6
+    + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+SelfProfile::SelfProfile()
+: phases(), mut()
+, start(std::chrono::steady_clock::now()) {}
+
+size_t SelfProfile::enter(const String &name, unsigned depth) {
+  std::unique_lock lock{mut};
+  const auto it = std::find_if(phases.cbegin(), phases.cend(), [&name, depth](const Phase &p) {
+    return p.name == name && p.depth == depth;
+  });
+  if(it != phases.cend()) {
+    return it - phases.cbegin();
+  }
+  phases.push_back(Phase{name, depth, 0, 0, 0, 0});
+  return phases.size() - 1;
+}
+
+void SelfProfile::leave(size_t index, double wall_sec, double cpu_sec, unsigned long spawned) {
+  std::unique_lock lock{mut};
+  auto &p = phases[index];
+  ++p.calls;
+  p.spawned += spawned;
+  p.wall_sec += wall_sec;
+  p.cpu_sec += cpu_sec;
+}
+
+void SelfProfile::print(std::ostream &os) {
+  std::unique_lock lock{mut};
+  const auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  os << termcolor::bold << "-- Self profile --" << termcolor::reset << std::endl;
+  os << std::left << std::setw(24) << "phase" << std::right
+    << std::setw(8) << "calls" << std::setw(11) << "wall(s)"
+    << std::setw(11) << "cpu(s)" << std::setw(9) << "spawned" << std::endl;
+  for(const auto &p : phases) {
+    os << std::left << std::setw(24) << (String(2 * p.depth, ' ') + p.name) << std::right
+      << std::setw(8) << p.calls
+      << std::setw(11) << format_fixed(p.wall_sec, 3)
+      << std::setw(11) << format_fixed(p.cpu_sec, 3)
+      << std::setw(9) << p.spawned << std::endl;
+  }
+  os << termcolor::bright_grey
+    << "Total " << format_fixed(wall, 3) << " sec wall; pincheck used "
+    << format_fixed(rusage_cpu_sec(RUSAGE_SELF), 3) << " sec CPU over all threads, its children "
+    << format_fixed(rusage_cpu_sec(RUSAGE_CHILDREN), 3) << " sec; "
+    << spawned_processes() << " processes spawned." << termcolor::reset << std::endl;
+}
+
+ProfileScope::ProfileScope(SelfProfile *profile, String name)
+: profile(profile), index(0)
+, spawned(0), start(), cpu_start(0) {
+  if(!profile) return;
+  index = profile->enter(name, scope_depth++);
+  spawned = spawned_processes_here();
+  start = std::chrono::steady_clock::now();
+  cpu_start = thread_cpu_sec();
+}
+
+ProfileScope::~ProfileScope() {
+  if(!profile) return;
+  --scope_depth;
+  profile->leave(index,
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+    thread_cpu_sec() - cpu_start,
+    spawned_processes_here() - spawned);
+}
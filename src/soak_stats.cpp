@@ -0,0 +1,146 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include "execution.h"
+#include "soak_stats.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+static size_t bucket_of(double sec) {
+  size_t b = 0;
+  for(double bound = 1; b + 1 < SOAK_BUCKETS && sec >= bound; bound *= 2) {
+    ++b;
+  }
+  return b;
+}
+
+static String bucket_label(size_t b) {
+  if(b + 1 == SOAK_BUCKETS) {
+    return ">=" + std::to_string(1u << (b - 1)) + "s";
+  }
+  return "<" + std::to_string(1u << b) + "s";
+}
+
+SoakCounter::SoakCounter()
+: runs(0), passed(0), failed(0)
+, total_sec(0), max_sec(0)
+, histogram{} {}
+
+SoakStats::SoakStats(Path spill_dir)
+: counters()
+, epochs(0), epochs_passed(0)
+, spilled(0)
+, spill_dir(std::move(spill_dir))
+, start_time(std::chrono::system_clock::now()) {
+  std::ostringstream panic_msg;
+  try {
+    fs::create_directories(this->spill_dir);
+  } catch (const fs::filesystem_error& fe) {
+    panic_msg << "Cannot make the directory for failing outputs:" << std::endl;
+    panic_msg << "\t" << fe.what();
+    panic(panic_msg);
+  }
+}
+
+Optional<Path> SoakStats::record(const TestResult &result, unsigned epoch) {
+  const auto full_name = result.testcase.full_name();
+  const double sec = std::chrono::duration<double>(result.end_time - result.start_time).count();
+
+  auto &counter = counters[full_name];
+  ++counter.runs;
+  counter.total_sec += sec;
+  counter.max_sec = std::max(counter.max_sec, sec);
+  ++counter.histogram[bucket_of(sec)];
+  if(result.passed) {
+    ++counter.passed;
+    return std::nullopt;
+  }
+  ++counter.failed;
+
+  // spill the failing output, as the next epoch overwrites it
+  auto flat_name = full_name;
+  std::replace(flat_name.begin(), flat_name.end(), '/', '_');
+  const auto spill_base = spill_dir / ("epoch" + std::to_string(epoch) + "-" + flat_name);
+
+  std::ofstream spill_fs(String{spill_base} + ".result");
+  if(!spill_fs.is_open()) {
+    return std::nullopt;
+  }
+  spill_fs << "code : " << result.exit_code << '\n';
+  spill_fs << "dump : " << result.dump << '\n';
+  if(result.except_dump) {
+    spill_fs << "except_dump : " << result.except_dump << '\n';
+  }
+  spill_fs.close();
+
+  std::error_code ec;
+  fs::copy_file(full_name + ".output", String{spill_base} + ".output",
+    fs::copy_options::overwrite_existing, ec);
+
+  ++spilled;
+  return Path{String{spill_base} + ".result"};
+}
+
+void SoakStats::end_epoch(bool passed) {
+  ++epochs;
+  if(passed) ++epochs_passed;
+}
+
+unsigned SoakStats::get_epochs() const {
+  return epochs;
+}
+
+unsigned SoakStats::get_epochs_passed() const {
+  return epochs_passed;
+}
+
+std::chrono::seconds SoakStats::elapsed() const {
+  return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - start_time);
+}
+
+void SoakStats::print_summary(std::ostream &os, bool full) const {
+  unsigned runs = 0, failed = 0;
+  std::array<unsigned, SOAK_BUCKETS> histogram{};
+  for(const auto &[name, c] : counters) {
+    runs += c.runs;
+    failed += c.failed;
+    for(size_t b = 0; b < SOAK_BUCKETS; ++b) {
+      histogram[b] += c.histogram[b];
+    }
+  }
+
+  os << termcolor::bold << "Soak " << format_duration(elapsed()) << termcolor::reset
+    << " | epochs " << termcolor::green << epochs_passed << " passed" << termcolor::reset
+    << ", " << termcolor::red << (epochs - epochs_passed) << " failed" << termcolor::reset
+    << " | runs " << runs << ", " << termcolor::red << failed << " failed" << termcolor::reset
+    << " | spilled " << spilled << std::endl;
+
+  Vector<std::pair<String, const SoakCounter*>> flaky;
+  for(const auto &[name, c] : counters) {
+    if(c.failed) flaky.emplace_back(name, &c);
+  }
+  if(!full && flaky.empty()) return;
+
+  if(!flaky.empty()) {
+    os << termcolor::bright_red << "-- Failing tests --" << termcolor::reset << std::endl;
+    for(const auto &[name, c] : flaky) {
+      os << name << termcolor::bright_grey << " failed " << c->failed << "/" << c->runs
+        << " (" << format_fixed(100.0 * c->failed / c->runs, 1) << "%)"
+        << termcolor::reset << std::endl;
+    }
+  }
+  if(!full) return;
+
+  os << "-- Duration histogram --" << std::endl;
+  for(size_t b = 0; b < SOAK_BUCKETS; ++b) {
+    if(histogram[b] == 0) continue;
+    os << std::setw(6) << bucket_label(b) << " : " << histogram[b] << std::endl;
+  }
+
+  os << "-- Per-test durations (mean / max) --" << std::endl;
+  for(const auto &[name, c] : counters) {
+    os << name << termcolor::bright_grey << " "
+      << format_fixed(c.total_sec / c.runs, 1) << "s / " << format_fixed(c.max_sec, 1) << "s over " << c.runs << " runs"
+      << termcolor::reset << std::endl;
+  }
+}
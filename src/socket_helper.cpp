@@ -0,0 +1,55 @@
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "socket_helper.h"
+
+bool fill_address(const Path &socket, sockaddr_un &addr) {
+  const String s{socket};
+  addr = sockaddr_un{};
+  addr.sun_family = AF_UNIX;
+  if(s.size() >= sizeof(addr.sun_path)) return false;
+  std::memcpy(addr.sun_path, s.c_str(), s.size() + 1);
+  return true;
+}
+
+int connect_socket(const Path &socket) {
+  sockaddr_un addr;
+  if(!fill_address(socket, addr)) return -1;
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if(fd < 0) return -1;
+  if(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool send_all(int fd, const String &bytes) {
+  size_t done = 0;
+  while(done < bytes.size()) {
+    const auto r = send(fd, bytes.data() + done, bytes.size() - done, MSG_NOSIGNAL);
+    if(r < 0 && errno == EINTR) continue;
+    if(r <= 0) return false;
+    done += r;
+  }
+  return true;
+}
+
+Optional<String> read_line(int fd, String &buffer, size_t max_line) {
+  while(true) {
+    const auto nl = buffer.find('\n');
+    if(nl != String::npos) {
+      auto line = buffer.substr(0, nl);
+      buffer.erase(0, nl + 1);
+      return line;
+    }
+    if(buffer.size() > max_line) return std::nullopt;
+
+    Buffer chunk;
+    const auto r = recv(fd, chunk.data(), chunk.size(), 0);
+    if(r < 0 && errno == EINTR) continue;
+    if(r <= 0) return std::nullopt;
+    buffer.append(chunk.data(), r);
+  }
+}
@@ -0,0 +1,186 @@
+#include <iostream>
+#include <atomic>
+#include <unistd.h>
+
+#include "status_renderer.h"
+#include "console_helper.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+constexpr size_t PROGRESS_BAR_WIDTH = 20;
+
+static volatile sig_atomic_t winch_received = 0;
+
+static void on_winch(int) {
+  winch_received = 1;
+}
+
+static unsigned short query_columns() {
+  const auto ws = get_winsize(STDOUT_FILENO);
+  return ws.ws_col ? ws.ws_col : 80;
+}
+
+StatusRenderer::StatusRenderer(const RunProgress *progress, std::chrono::milliseconds min_interval)
+: is_tty(isatty(STDOUT_FILENO))
+, min_interval(min_interval), heartbeat_interval(std::chrono::seconds(30))
+, last_frame{}, last_heartbeat(std::chrono::system_clock::now())
+, rows(), frame(), last_status()
+, columns(80), old_winch{}
+, progress(progress), overdue_tests() {
+  if(is_tty) {
+    termcolor::colorize(rows);
+    columns = query_columns();
+
+    struct sigaction sa{};
+    sa.sa_handler = on_winch;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &sa, &old_winch);
+  }
+}
+
+StatusRenderer::~StatusRenderer() noexcept {
+  if(is_tty) {
+    sigaction(SIGWINCH, &old_winch, nullptr);
+  }
+}
+
+void StatusRenderer::set_progress(const RunProgress *progress) {
+  this->progress = progress;
+  overdue_tests.clear();
+}
+
+bool StatusRenderer::tty() const {
+  return is_tty;
+}
+
+std::ostream &StatusRenderer::row_stream() {
+  return rows;
+}
+
+String StatusRenderer::compose_progress(const Vector<std::unique_ptr<TestRunner>> &pool) {
+  const auto f = progress->fraction(pool);
+  const auto filled = static_cast<size_t>(f * PROGRESS_BAR_WIDTH);
+  String ret = "[" + String(filled, '#') + String(PROGRESS_BAR_WIDTH - filled, '-') + "] ";
+  ret += std::to_string(static_cast<int>(f * 100)) + "% ";
+  if(const auto eta = progress->eta(pool)) {
+    ret += "ETA " + format_duration(*eta) + " ";
+  }
+  return ret;
+}
+
+String StatusRenderer::compose_status(const Vector<std::unique_ptr<TestRunner>> &pool, bool colored) {
+  using namespace std::string_literals;
+  const String omit_msg = " ... ";
+  constexpr size_t COL_JITTER = 3;
+
+  const auto running_pools = std::count_if(pool.cbegin(), pool.cend(),
+    [](const std::unique_ptr<TestRunner>& p){return p!=nullptr;});
+  const String full_pool_msg = "Running"s + "(" + std::to_string(running_pools) + "/" + std::to_string(pool.size()) + ") : ";
+  const String progress_msg = progress ? compose_progress(pool) : "";
+
+  std::ostringstream os;
+  if(colored) termcolor::colorize(os);
+  os << termcolor::reset << termcolor::bold << progress_msg << termcolor::yellow << full_pool_msg
+    << termcolor::reset << termcolor::yellow;
+
+  size_t width = progress_msg.size() + full_pool_msg.size();
+  for(auto& p : pool) {
+    if(!p) continue;
+    const auto &testcase = p->get_test_case();
+    const auto print = (progress ? p->get_print(progress->expected_sec(testcase)) : p->get_print()) + " ";
+    if(colored && width + print.size() + COL_JITTER >= columns) {
+      os << omit_msg;
+      break;
+    }
+    width += print.size();
+    if(overdue_tests.count(testcase.full_name())) {
+      os << termcolor::red << print << termcolor::yellow;
+    } else if(testcase.persistence) {
+      os << termcolor::magenta << print << termcolor::yellow;
+    } else {
+      os << print;
+    }
+  }
+  os << termcolor::reset;
+  return os.str();
+}
+
+void StatusRenderer::write_frame() {
+  // whatever went through std::cout must come first
+  std::cout.flush();
+
+  size_t done = 0;
+  while(done < frame.size()) {
+    const auto r = write(STDOUT_FILENO, frame.data() + done, frame.size() - done);
+    if(r < 0) {
+      if(errno == EINTR) continue;
+      break;
+    }
+    done += r;
+  }
+  frame.clear();
+}
+
+// flags each test once, with a row, when it becomes overdue
+void StatusRenderer::check_overdue(const Vector<std::unique_ptr<TestRunner>> &pool) {
+  for(const auto &p : pool) {
+    if(!p) continue;
+    const auto &testcase = p->get_test_case();
+    const auto elapsed = p->get_elapsed_sec();
+    if(!progress->overdue(testcase, elapsed) || overdue_tests.count(testcase.full_name())) continue;
+
+    overdue_tests.insert(testcase.full_name());
+    rows << termcolor::red << "Still running: " << testcase.full_name() << " for "
+      << static_cast<long>(elapsed) << "s, usually " << format_fixed(*progress->expected_sec(testcase), 1)
+      << "s; it may hang (TIMEOUT " << testcase.timeout << "s)" << termcolor::reset << '\n';
+  }
+}
+
+void StatusRenderer::render(const Vector<std::unique_ptr<TestRunner>> &pool, bool force) {
+  const auto now = std::chrono::system_clock::now();
+  if(progress) {
+    check_overdue(pool);
+  }
+  const auto pending_rows = rows.tellp() > 0;
+  if(!force && !pending_rows && now - last_frame < min_interval) {
+    return;
+  }
+
+  if(is_tty) {
+    if(winch_received) {
+      winch_received = 0;
+      columns = query_columns();
+    }
+
+    auto status = compose_status(pool, true);
+    if(!force && !pending_rows && status == last_status) {
+      return;
+    }
+    frame += "\033[2K\033[1G";
+    frame += rows.str();
+    frame += status;
+    last_status = std::move(status);
+  } else {
+    frame += rows.str();
+    if(force || now - last_heartbeat >= heartbeat_interval) {
+      frame += compose_status(pool, false);
+      frame += '\n';
+      last_heartbeat = now;
+    }
+  }
+
+  rows.str("");
+  last_frame = now;
+  write_frame();
+}
+
+void StatusRenderer::clear() {
+  if(is_tty) {
+    frame += "\033[2K\033[1G";
+  }
+  frame += rows.str();
+  rows.str("");
+  last_status.clear();
+  write_frame();
+}
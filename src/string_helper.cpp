@@ -1,4 +1,6 @@
 #include <regex>
+#include <sstream>
+#include <iomanip>
 #include "string_helper.h"
 
 String string_trim(String s) {
@@ -55,4 +57,120 @@ bool wildcard_match(const String &target, const Vector<String> &patterns) {
   return std::any_of(patterns.cbegin(), patterns.cend(), [&target](const String& pat){
     return wildcard_match(target, pat);
   });
-}
\ No newline at end of file
+}
+
+Optional<std::chrono::seconds> parse_duration(const String &s) {
+  // e.g. "90", "90s", "30m", "8h", "2d", "1h30m"
+  const auto target = string_trim(s);
+  if(target.empty()) return std::nullopt;
+  // longer could not be compared with a clock counting nanoseconds
+  const long long max_sec = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::nanoseconds::max()).count();
+
+  long long total = 0;
+  size_t i = 0;
+  while(i < target.size()) {
+    if(!std::isdigit(target[i])) return std::nullopt;
+    long long value = 0;
+    for(; i < target.size() && std::isdigit(target[i]); ++i) {
+      value = value * 10 + (target[i] - '0');
+      if(value > max_sec) return std::nullopt;
+    }
+
+    long long unit = 1;
+    if(i < target.size()) {
+      switch(target[i]) {
+        case 's': unit = 1; break;
+        case 'm': unit = 60; break;
+        case 'h': unit = 60 * 60; break;
+        case 'd': unit = 24 * 60 * 60; break;
+        default: return std::nullopt;
+      }
+      ++i;
+    }
+    if(value > (max_sec - total) / unit) return std::nullopt;
+    total += value * unit;
+  }
+
+  // no time at all is a mistake, not a run of nothing
+  if(total == 0) return std::nullopt;
+  return std::chrono::seconds{total};
+}
+
+String format_duration(std::chrono::seconds d) {
+  auto total = d.count();
+  const auto hours = total / 3600;
+  const auto minutes = (total / 60) % 60;
+  const auto seconds = total % 60;
+
+  String ret = std::to_string(hours) + ":";
+  if(minutes < 10) ret += "0";
+  ret += std::to_string(minutes) + ":";
+  if(seconds < 10) ret += "0";
+  ret += std::to_string(seconds);
+  return ret;
+}
+
+String format_fixed(double value, int precision) {
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(precision) << value;
+  return os.str();
+}
+
+String json_escape(const String &s) {
+  String ret;
+  ret.reserve(s.size());
+  for(const unsigned char c : s) {
+    switch(c) {
+      case '"': ret += "\\\""; break;
+      case '\\': ret += "\\\\"; break;
+      case '\n': ret += "\\n"; break;
+      case '\r': ret += "\\r"; break;
+      case '\t': ret += "\\t"; break;
+      default:
+        if(c < 0x20) {
+          constexpr char HEX[] = "0123456789abcdef";
+          ret += "\\u00";
+          ret += HEX[c >> 4];
+          ret += HEX[c & 0xf];
+        } else {
+          ret += c;
+        }
+    }
+  }
+  return ret;
+}
+
+String xml_escape(const String &s) {
+  String ret;
+  ret.reserve(s.size());
+  for(const unsigned char c : s) {
+    switch(c) {
+      case '&': ret += "&amp;"; break;
+      case '<': ret += "&lt;"; break;
+      case '>': ret += "&gt;"; break;
+      case '"': ret += "&quot;"; break;
+      case '\'': ret += "&apos;"; break;
+      default:
+        // control characters are not allowed in XML 1.0
+        if(c < 0x20 && c != '\n' && c != '\r' && c != '\t') {
+          ret += '?';
+        } else {
+          ret += c;
+        }
+    }
+  }
+  return ret;
+}
+
+String shell_quote(const String &s) {
+  String ret = "'";
+  for(const auto c : s) {
+    if(c == '\'') {
+      ret += "'\\''";
+    } else {
+      ret += c;
+    }
+  }
+  ret += '\'';
+  return ret;
+}
@@ -0,0 +1,204 @@
+#include <fstream>
+#include <unordered_map>
+
+#include "test_discovery.h"
+#include "execution.h"
+#include "string_helper.h"
+
+namespace {
+
+struct CacheEntry {
+  bool persistence;
+  int timeout;
+};
+
+}
+
+TestFilter::TestFilter()
+: names{"*"}, subdirs{"*"}
+, exclude_names(), exclude_subdirs() {}
+
+bool TestFilter::accepts(const String &subdir, const String &name) const {
+  return wildcard_match(subdir, subdirs) && wildcard_match(name, names)
+    && !wildcard_match(subdir, exclude_subdirs) && !wildcard_match(name, exclude_names);
+}
+
+int parse_timeout(const String &command) {
+  constexpr int DEFAULT_TIMEOUT = 60;
+  const auto tokens = string_tokenize(command);
+
+  auto it = std::find(tokens.cbegin(), tokens.cend(), "-T");
+  if(it == tokens.cend()) {
+    return DEFAULT_TIMEOUT;
+  }
+
+  ++it;
+  if(it == tokens.cend()) {
+    return DEFAULT_TIMEOUT;
+  }
+
+  int ret;
+  try {
+    ret = std::stoi(*it);
+  } catch (const std::exception &e) {
+    ret = DEFAULT_TIMEOUT;
+  }
+
+  return ret;
+}
+
+Optional<String> get_raw_running_command(const Path &build, const String &full_name) {
+  using namespace std::string_literals;
+  std::ostringstream panic_msg;
+  const auto get_run_cmd_command = "make -C "s + shell_quote(build) + " " + full_name
+    + ".output --dry-run --silent --assume-old=os.dsk --what-if=os.dsk";
+
+  const auto get_run_cmd_result = exec_str(get_run_cmd_command.c_str());
+  if (get_run_cmd_result.first != 0 || !get_run_cmd_result.second) {
+    panic_msg << "Cannot find out the command line to run the case";
+    panic(panic_msg);
+  }
+
+  auto full_run_command = string_trim(*(get_run_cmd_result.second));
+  if(std::count(full_run_command.begin(), full_run_command.end(), '\n') >= 2) {
+    return std::nullopt;
+  }
+
+  return full_run_command;
+}
+
+static Vector<String> make_pincheck(const Path &build, const char *target) {
+  using namespace std::string_literals;
+  std::ostringstream panic_msg;
+  const auto cmd = "make -C "s + shell_quote(build) + " " + target + " --silent -f Make.pincheck";
+  const auto res = exec_str(cmd.c_str());
+  if (res.first != 0 || !res.second.has_value()) {
+    panic_msg << "Cannot extract " << target << " of " << build;
+    panic(panic_msg);
+  }
+  return string_tokenize(*res.second);
+}
+
+DiscoveredTests discover_tests(const TestPath &paths, const TestFilter &filter, SelfProfile *profile) {
+  std::ostringstream panic_msg;
+  Optional<ProfileScope> step_profile;
+
+  step_profile.emplace(profile, "make tests");
+  std::ofstream make_pincheck_file{paths.build / "Make.pincheck"};
+  if(!make_pincheck_file.is_open()){
+    panic_msg << "Cannot make temp file to extract list of tests.";
+    panic(panic_msg);
+  }
+  make_pincheck_file
+    << "# -*- makefile -*-\n\n"
+    << "SRCDIR = ../..\n\n"
+    << ".PHONY: tests grade_file\n\n"
+    << "tests:\n\t@echo $(TESTS) $(EXTRA_GRADES) "
+    << "$(foreach subdir,$(TEST_SUBDIRS),$($(subdir)_GRADES))\n\n"
+    << "grade_file:\n\t@echo $(GRADING_FILE)\n\n"
+    << "include ../../Make.config\n"
+    << "include ../Make.vars\n"
+    << "include ../../tests/Make.tests\n";
+  make_pincheck_file.close();
+  const auto all_tests = make_pincheck(paths.build, "tests");
+
+  // pincheck cache
+  step_profile.emplace(profile, "cache load");
+  const auto cache_path = paths.build / "cache.pincheck";
+  std::ifstream cache_file_input{cache_path};
+  std::unordered_map<String, CacheEntry> cache_map;
+  if(cache_file_input.is_open()) {
+    String line;
+    while(std::getline(cache_file_input, line)) {
+      auto tokens = string_tokenize(line);
+      if(tokens.size() != 3) {
+        continue;
+      }
+
+      bool persistence;
+      int timeout;
+      try {
+        persistence = (std::stoi(tokens[1]) != 0);
+        timeout = std::stoi(tokens[2]);
+      } catch (std::exception&) {
+        continue;
+      }
+      cache_map[tokens[0]] = CacheEntry{.persistence = persistence, .timeout = timeout};
+    }
+    cache_file_input.close();
+  }
+  step_profile.reset();
+
+  DiscoveredTests ret;
+  for(const auto& _test : all_tests) {
+    const auto& test = string_trim(_test);
+
+    const auto test_path = Path{test};
+    auto name = String{test_path.filename()};
+    auto subdir = String{test_path.parent_path()};
+
+    if(!filter.accepts(subdir, name)) continue;
+
+    TestCase here(std::move(subdir), std::move(name));
+
+    auto cache_it = cache_map.find(here.full_name());
+    bool add_to_cache = false;
+    if(cache_it != cache_map.end()) {
+      here.timeout = cache_it->second.timeout;
+      here.persistence = cache_it->second.persistence;
+    } else {
+      step_profile.emplace(profile, "dry-run");
+      const auto opt_cmd = get_raw_running_command(paths.build, here.full_name());
+      step_profile.reset();
+      if(!opt_cmd) {
+        auto pers_it = std::find(all_tests.cbegin(), all_tests.cend(), here.full_name() + "-persistence");
+        if(pers_it != all_tests.cend()) {
+          here.persistence = true;
+          here.timeout = 60;
+        } else {
+          continue;
+        }
+      } else {
+        here.timeout = parse_timeout(*opt_cmd);
+      }
+
+      add_to_cache = true;
+    }
+
+    if (here.persistence) {
+      ret.persistence_tests.push_back(here);
+    } else {
+      ret.target_tests.push_back(here);
+    }
+    if(add_to_cache) {
+      CacheEntry entry;
+      entry.persistence = here.persistence;
+      entry.timeout = here.timeout;
+      cache_map[here.full_name()] = entry;
+    }
+  }
+  step_profile.emplace(profile, "cache store");
+  std::ofstream cache_file_output{cache_path};
+  if(cache_file_output.is_open()) {
+    for(const auto &[s, e]: cache_map) {
+      cache_file_output << s << ' ' << static_cast<int>(e.persistence) << ' ' << e.timeout << '\n';
+    }
+    cache_file_output.close();
+  }
+
+  step_profile.emplace(profile, "parse_rubric");
+  const auto grade_file = make_pincheck(paths.build, "grade_file");
+  const auto grading = grade_file.empty() ? Path{} : paths.build / grade_file[0];
+  ret.rubrics = parse_rubric(grading, paths.src, ret.target_tests, ret.persistence_tests);
+
+  return ret;
+}
+
+DiscoveredTests filter_tests(const DiscoveredTests &all, const TestFilter &filter) {
+  DiscoveredTests ret;
+  const auto accepted = [&filter](const TestCase &t){return filter.accepts(t.subdir, t.name);};
+  std::copy_if(all.target_tests.cbegin(), all.target_tests.cend(), std::back_inserter(ret.target_tests), accepted);
+  std::copy_if(all.persistence_tests.cbegin(), all.persistence_tests.cend(), std::back_inserter(ret.persistence_tests), accepted);
+  ret.rubrics = all.rubrics;
+  return ret;
+}
@@ -0,0 +1,89 @@
+#include <fstream>
+#include "test_history.h"
+#include "string_helper.h"
+
+// weight of the newest run in the mean
+constexpr double HISTORY_ALPHA = 0.3;
+
+HistoryEntry::HistoryEntry()
+: runs(0), mean_sec(0), last_sec(0), cpu_sec(0) {}
+
+TestHistory::TestHistory(Path file)
+: entries(), file(std::move(file)) {
+  std::ifstream history_fs{this->file};
+  if(!history_fs.is_open()) {
+    return;
+  }
+
+  String line;
+  while(std::getline(history_fs, line)) {
+    const auto tokens = string_tokenize(line);
+    if(tokens.size() < 4) {
+      continue;
+    }
+
+    HistoryEntry entry;
+    try {
+      entry.runs = std::stoul(tokens[1]);
+      entry.mean_sec = std::stod(tokens[2]);
+      entry.last_sec = std::stod(tokens[3]);
+      if(tokens.size() > 4) entry.cpu_sec = std::stod(tokens[4]);
+    } catch (std::exception&) {
+      continue;
+    }
+    entries[tokens[0]] = entry;
+  }
+}
+
+const HistoryEntry *TestHistory::find(const String &full_name) const {
+  const auto it = entries.find(full_name);
+  return it == entries.end() ? nullptr : &it->second;
+}
+
+double TestHistory::estimate_sec(const TestCase &testcase) const {
+  if(const auto entry = find(testcase.full_name())) {
+    return entry->mean_sec;
+  }
+  if(entries.empty()) {
+    return testcase.timeout;
+  }
+
+  double sum = 0;
+  for(const auto &[name, e] : entries) {
+    sum += e.mean_sec;
+  }
+  return sum / entries.size();
+}
+
+double TestHistory::cpu_share(const TestCase &testcase) const {
+  const auto entry = find(testcase.full_name());
+  if(!entry || entry->mean_sec <= 0) {
+    return 1;
+  }
+  return std::min(1.0, entry->cpu_sec / entry->mean_sec);
+}
+
+size_t TestHistory::size() const {
+  return entries.size();
+}
+
+void TestHistory::record(const TestResult &result) {
+  const auto sec = result.duration_sec();
+  const auto cpu = result.usage.user_sec + result.usage.sys_sec;
+  auto &entry = entries[result.testcase.full_name()];
+  entry.mean_sec = entry.runs == 0 ? sec : HISTORY_ALPHA * sec + (1 - HISTORY_ALPHA) * entry.mean_sec;
+  entry.cpu_sec = entry.runs == 0 ? cpu : HISTORY_ALPHA * cpu + (1 - HISTORY_ALPHA) * entry.cpu_sec;
+  entry.last_sec = sec;
+  ++entry.runs;
+}
+
+void TestHistory::save() const {
+  std::ofstream history_fs{file};
+  if(!history_fs.is_open()) {
+    return;
+  }
+  for(const auto &[name, e] : entries) {
+    history_fs << name << ' ' << e.runs << ' ' << format_fixed(e.mean_sec, 3) << ' ' << format_fixed(e.last_sec, 3)
+      << ' ' << format_fixed(e.cpu_sec, 3) << '\n';
+  }
+}
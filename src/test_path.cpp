@@ -75,22 +75,11 @@ Path detect_build(TestPath &paths, bool verbose, bool clean) {
   }
 
   // make project
-  const auto cmd = "make -j " + std::to_string(HARDWARE_CONCURRENCY) + " -C "s + make_dir + " 2>&1"s;
   if (verbose)
-    std::cout << "Building '" << cmd << "'..." << std::flush;
-  const auto make_ret = exec_str(cmd.c_str());
-  if(!make_ret.second.has_value()) {
-    panic_msg << "FAILURE : cannot properly execute " << cmd;
-    panic(panic_msg);
-  }
-  if(make_ret.first != 0) {
-    panic_msg << "make command exited with nonzero code: " << make_ret.first;
-    panic_msg << std::endl << "See detailed output: " << *make_ret.second;
-    panic(panic_msg);
-  }
-  paths.build = paths.src / paths.project / "build";
-  if(!fs::exists(paths.build / "kernel.bin")) {
-    panic_msg << "make command didn't make kernel.";
+    std::cout << "Building '" << make_dir << "'..." << std::flush;
+  String output;
+  if(!make_build(paths, HARDWARE_CONCURRENCY, output)) {
+    panic_msg << output;
     panic(panic_msg);
   }
 
@@ -100,6 +89,27 @@ Path detect_build(TestPath &paths, bool verbose, bool clean) {
   return paths.build;
 }
 
+bool make_build(TestPath &paths, unsigned jobs, String &output) {
+  using namespace std::string_literals;
+  std::ostringstream msg;
+
+  const auto cmd = "make -j " + std::to_string(jobs) + " -C "s + shell_quote(paths.src / paths.project) + " 2>&1"s;
+  const auto make_ret = exec_str(cmd.c_str());
+  paths.build = paths.src / paths.project / "build";
+  if(!make_ret.second.has_value()) {
+    msg << "FAILURE : cannot properly execute " << cmd;
+  } else if(make_ret.first != 0) {
+    msg << "make command exited with nonzero code: " << make_ret.first;
+    msg << std::endl << "See detailed output: " << *make_ret.second;
+  } else if(!fs::exists(paths.build / "kernel.bin")) {
+    msg << "make command didn't make kernel.";
+  } else {
+    return true;
+  }
+  output = msg.str();
+  return false;
+}
+
 Path make_pool(TestPath &paths, size_t size) {
   std::ostringstream panic_msg;
   try {
@@ -148,3 +158,11 @@ Path make_pool(TestPath &paths, size_t size) {
     panic(panic_msg);
   }
 }
+
+Vector<Path> guess_builds(const Path &cwd, const String &project) {
+  Vector<Path> ret{cwd / "build", cwd};
+  if(!project.empty()) {
+    ret.push_back(cwd / project / "build");
+  }
+  return ret;
+}
@@ -1,39 +1,91 @@
 #include <iostream>
 #include <fstream>
 #include "execution.h"
+#include "string_helper.h"
 #include "test_result.h"
 #include "termcolor/termcolor.hpp"
 
 TestResult::TestResult
-  (const TestCase &testcase, bool passed, int exit_code, const String& dump, const char* except_dump,
+  (const TestCase &testcase, bool passed, int exit_code, String dump, const char* except_dump,
     std::chrono::system_clock::time_point start_time,
     std::chrono::system_clock::time_point end_time)
 : testcase(testcase)
 , passed(passed), exit_code(exit_code)
-, dump(dump), except_dump(except_dump)
-, start_time(start_time), end_time(end_time){
+, dump(std::move(dump)), except_dump(except_dump)
+, start_time(start_time), end_time(end_time)
+, usage(), run_sec(0), check_sec(0)
+, kernel(), kernel_prev() {
 }
 
-void TestResult::print_row(bool detail, bool verbose) const {
-  std::cout << termcolor::reset << termcolor::bold;
-  if(passed) std::cout << termcolor::green << "pass  ";
-  else if(except_dump || exit_code) std::cout << termcolor::bright_red << "ERROR ";
-  else std::cout << termcolor::red << "FAIL  ";
-  std::cout << termcolor::reset;
+void TestResult::print_row(std::ostream &os, bool detail, bool verbose) const {
+  os << termcolor::reset << termcolor::bold;
+  if(passed) os << termcolor::green << "pass  ";
+  else if(except_dump || exit_code) os << termcolor::bright_red << "ERROR ";
+  else os << termcolor::red << "FAIL  ";
+  os << termcolor::reset;
 
-  std::cout << testcase.full_name() << termcolor::bright_grey;
-  std::cout << " by "
+  os << testcase.full_name() << termcolor::bright_grey;
+  os << " by "
     << (std::chrono::duration_cast<std::chrono::seconds>(end_time - start_time)).count()
     << " sec" << termcolor::reset;
   if((!passed || verbose) && !testcase.subtitle.empty()) {
-    std::cout << termcolor::magenta << " [" << testcase.subtitle << "]" << termcolor::reset;
+    os << termcolor::magenta << " [" << testcase.subtitle << "]" << termcolor::reset;
+  }
+  if(verbose) {
+    os << termcolor::bright_grey
+      << "\n  run " << format_fixed(run_sec, 2) << "s, check " << format_fixed(check_sec, 2)
+      << "s, overhead " << format_fixed(overhead_sec(), 2) << "s"
+      << " | cpu " << format_fixed(usage.user_sec, 2) << "u " << format_fixed(usage.sys_sec, 2) << "s"
+      << " | rss " << usage.max_rss_kb / 1024 << " MB"
+      << " | ctxsw " << usage.nvcsw << "/" << usage.nivcsw
+      << " | blk " << usage.inblock << "/" << usage.oublock
+      << termcolor::reset;
+    if(!kernel.empty()) {
+      os << termcolor::bright_grey << "\n  kernel";
+      for(const auto &[name, value] : kernel.counters) {
+        if(value == 0) continue;
+        os << " " << name << " " << value;
+        const auto prev = kernel_prev ? kernel_prev->get(name) : std::nullopt;
+        if(prev && *prev != value) {
+          os << " (" << (value > *prev ? "+" : "") << (value - *prev) << ")";
+        }
+      }
+      os << termcolor::reset;
+    }
   }
   if(!passed && detail) {
-    std::cout << "\ncode : " << exit_code;
-    std::cout << "\ndump : " << dump;
+    os << "\ncode : " << exit_code;
+    os << "\ndump : " << dump;
     if(except_dump)
-      std::cout << "\nexcept_dump : " << except_dump;
-    std::cout << std::flush;
+      os << "\nexcept_dump : " << except_dump;
+    os << std::flush;
   }
-  std::cout << termcolor::reset;
+  os << termcolor::reset;
+}
+
+const char *TestResult::status() const {
+  if(passed) return "pass";
+  if(except_dump || exit_code) return "error";
+  return "fail";
+}
+
+String TestResult::reason() const {
+  if(passed) return {};
+  if(except_dump) return except_dump;
+
+  // .result files start with a PASS/FAIL line followed by the reason
+  String ret = dump;
+  if(ret.compare(0, 4, "FAIL") == 0) {
+    const auto first_newline = ret.find('\n');
+    ret = first_newline == String::npos ? String{} : ret.substr(first_newline + 1);
+  }
+  return string_trim(std::move(ret));
+}
+
+double TestResult::duration_sec() const {
+  return std::chrono::duration<double>(end_time - start_time).count();
+}
+
+double TestResult::overhead_sec() const {
+  return std::max(0.0, duration_sec() - run_sec - check_sec);
 }
@@ -1,8 +1,14 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <signal.h>
 #include "execution.h"
 #include "test_runner.h"
+#include "remote_worker.h"
+#include "string_helper.h"
 
 TestRunner::TestRunner(TestCase testcase)
 : testcase(std::move(testcase))
@@ -11,7 +17,10 @@ TestRunner::TestRunner(TestCase testcase)
 , exit_code(0), exit_code_pers(0)
 , dump(), dump_pers()
 , except_dump(nullptr)
+, usage(), run_sec(0), check_sec(0)
+, kernel(), kernel_pers()
 , start_time{}, end_time{}, fut{}, mut{}
+, cancelled(false), process()
 {
 }
 
@@ -54,86 +63,141 @@ const char* TestRunner::get_except_dump() {
   return except_dump;
 }
 
-void TestRunner::register_test(const TestPath& paths) noexcept {
+// Reads a .result file with as few syscalls as possible. The dump is only
+// materialized when the test failed or keep_dump is set; a passing result
+// costs a single small read.
+static Optional<Pair<bool, String>> read_result(const String &result_file, bool keep_dump) {
+  constexpr char PASS_LINE[] = "PASS\n";
+  constexpr size_t PASS_LEN = sizeof(PASS_LINE) - 1;
+
+  const int fd = open(result_file.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return std::nullopt;
+  }
+
+  struct stat st;
+  const size_t size = (fstat(fd, &st) == 0 && st.st_size > 0) ? st.st_size : 0;
+  String content(keep_dump ? size : std::min(size, PASS_LEN), '\0');
+
+  size_t done = 0;
+  while(done < content.size()) {
+    const auto r = read(fd, content.data() + done, content.size() - done);
+    if(r <= 0) break;
+    done += r;
+  }
+  content.resize(done);
+
+  const bool passed = content.compare(0, PASS_LEN, PASS_LINE) == 0 || content == "PASS";
+  if(!passed && !keep_dump) {
+    // failed; get the rest of the file as a dump
+    content.resize(size);
+    while(done < content.size()) {
+      const auto r = read(fd, content.data() + done, content.size() - done);
+      if(r <= 0) break;
+      done += r;
+    }
+    content.resize(done);
+  }
+  close(fd);
+
+  if(passed && !keep_dump) {
+    content.clear();
+  }
+  return Pair<bool, String>{passed, std::move(content)};
+}
+
+void TestRunner::register_test(const TestPath& paths, bool keep_dump, RemoteSlot *remote) noexcept {
   using namespace std::string_literals;
 
   try {
-    fut = std::async(std::launch::async, [this, &paths]() {
+    fut = std::async(std::launch::async, [this, &paths, keep_dump, remote]() {
       {
         std::unique_lock lock{mut};
         start_time = std::chrono::system_clock::now();
         running = true;
       }
+      // a panic here fails this test only
+      PanicScope panic_scope;
       try {
-        const auto result_file = testcase.full_name() + ".result";
-        const auto result_pers_file = testcase.full_name() + "-persistence.result";
-        const auto result_cmd = "make "s + String{testcase.persistence ? result_pers_file : result_file}
+        // files are addressed through paths.build, which need not be the cwd
+        const auto base = String{paths.build / testcase.full_name()};
+        const auto result_file = base + ".result";
+        const auto result_pers_file = base + "-persistence.result";
+        const auto target = testcase.persistence ? testcase.full_name() + "-persistence" : testcase.full_name();
+        const auto make = "make -C "s + shell_quote(paths.build) + " ";
+
+        // run phase: make the .output, i.e. the pintos launcher and qemu
+        const auto output_cmd = make + target + ".output"
           + " --silent --assume-old=os.dsk --what-if=os.dsk 2>&1";
-        const auto result_cmd_res = exec_str(result_cmd.c_str());
-        if(result_cmd_res.first != 0 || !result_cmd_res.second) {
+        ResourceUsage run_usage;
+        const auto run_start = std::chrono::system_clock::now();
+        Optional<int> remote_exit;
+        if(remote && !testcase.persistence) {
+          remote_exit = remote->run_output(paths, testcase, run_usage);
+        }
+        // as make would exit if the launcher failed
+        auto cmd_res = remote_exit
+          ? Pair<int, Optional<String>>{*remote_exit == 0 ? 0 : 2, String{}}
+          : exec_str(output_cmd.c_str(), run_usage, &process);
+        const auto run_end = std::chrono::system_clock::now();
+
+        // check phase: make the .result with .ck; the .output is up to date by now
+        ResourceUsage check_usage;
+        if(cmd_res.first == 0 && cmd_res.second && !cancelled) {
+          const auto result_cmd = make + target + ".result"
+            + " --silent --assume-old=os.dsk 2>&1";
+          cmd_res = exec_str(result_cmd.c_str(), check_usage, &process);
+        }
+        const auto check_end = std::chrono::system_clock::now();
+
+        {
+          std::unique_lock lock{mut};
+          usage = run_usage;
+          usage += check_usage;
+          run_sec = std::chrono::duration<double>(run_end - run_start).count();
+          check_sec = std::chrono::duration<double>(check_end - run_end).count();
+        }
+
+        if(cmd_res.first != 0 || !cmd_res.second || cancelled) {
           {
             std::unique_lock lock{mut};
-            dump = dump_pers = "Cannot run making result file properly";
+            dump = dump_pers = cancelled ? "Cancelled through the control socket" : "Cannot run making result file properly";
             end_time = std::chrono::system_clock::now();
             finished = true;
-            exit_code = exit_code_pers = result_cmd_res.first;
+            exit_code = exit_code_pers = cmd_res.first;
           }
           return;
         }
 
-        std::ostringstream os;
-        std::string line;
-        std::ifstream res_fs(result_file);
-        if(!res_fs.is_open()) {
+        {
+          auto res = read_result(result_file, keep_dump);
+          auto stats = read_kernel_stats(base + ".output");
           std::unique_lock lock{mut};
-          dump = "Cannot open result file";
-          passed = false;
-          exit_code = -1;
-        } else {
-          bool first_pass = false;
-          bool first_line = true;
-          while(std::getline(res_fs, line)) {
-            if(first_line) {
-              first_line = false;
-              if(line == "PASS") {
-                first_pass = true;
-              }
-            }
-            os << line << '\n';
-          }
-          {
-            std::unique_lock lock{mut};
-            dump = os.str();
-            passed = first_pass;
+          kernel = std::move(stats);
+          if(!res) {
+            dump = "Cannot open result file";
+            passed = false;
+            exit_code = -1;
+          } else {
+            passed = res->first;
+            dump = std::move(res->second);
             exit_code = 0;
           }
         }
 
         if(testcase.persistence) {
-          std::ifstream res_fs(result_pers_file);
-          if(!res_fs.is_open()) {
-            std::unique_lock lock{mut};
+          auto res = read_result(result_pers_file, keep_dump);
+          auto stats = read_kernel_stats(base + "-persistence.output");
+          std::unique_lock lock{mut};
+          kernel_pers = std::move(stats);
+          if(!res) {
             dump_pers = "Cannot open result file";
             passed_pers = false;
             exit_code_pers = -1;
           } else {
-            bool first_pass = false;
-            bool first_line = true;
-            while(std::getline(res_fs, line)) {
-              if(first_line) {
-                first_line = false;
-                if(line == "PASS") {
-                  first_pass = true;
-                }
-              }
-              os << line << '\n';
-            }
-            {
-              std::unique_lock lock{mut};
-              dump_pers = os.str();
-              passed_pers = first_pass;
-              exit_code_pers = 0;
-            }
+            passed_pers = res->first;
+            dump_pers = std::move(res->second);
+            exit_code_pers = 0;
           }
         }
         
@@ -147,7 +211,10 @@ void TestRunner::register_test(const TestPath& paths) noexcept {
         const auto output_get_cmd = "make "s + std::string{output_path}
           + " --dry-run --silent --assume-old=os.dsk --what-if=os.dsk";*/
       } catch (const std::exception& e) {
-        except_dump = e.what();
+        // what() dies with the exception; the message is kept as the dump
+        std::unique_lock lock{mut};
+        dump = dump_pers = e.what();
+        exit_code = exit_code_pers = -1;
         end_time = std::chrono::system_clock::now();
         finished = true;
       }
@@ -159,7 +226,18 @@ void TestRunner::register_test(const TestPath& paths) noexcept {
   }
 }
 
-String TestRunner::get_print() {
+void TestRunner::cancel() {
+  cancelled = true;
+  process.kill_tree(SIGKILL);
+}
+
+double TestRunner::get_elapsed_sec() {
+  std::unique_lock lock{mut};
+  if(!running) return 0;
+  return std::chrono::duration<double>(std::chrono::system_clock::now() - start_time).count();
+}
+
+String TestRunner::get_print(Optional<double> expected_sec) {
   std::unique_lock lock{mut};
   std::ostringstream os;
 
@@ -172,18 +250,37 @@ String TestRunner::get_print() {
     os << std::chrono::duration_cast<std::chrono::seconds>(
       std::chrono::system_clock::now() - start_time
     ).count();
-    os << "s]";
+    os << "s";
+    if(expected_sec) {
+      os << "/";
+      if(*expected_sec < 10) {
+        os << format_fixed(*expected_sec, 1);
+      } else {
+        os << static_cast<long>(*expected_sec + 0.5);
+      }
+      os << "s";
+    }
+    os << "]";
   }
 
   return os.str();
 }
 
 Vector<TestResult> TestRunner::get_results() {
+  std::unique_lock lock{mut};
   Vector<TestResult> ret;
-  ret.emplace_back(testcase, passed, exit_code, dump, except_dump, start_time, end_time);
+  ret.emplace_back(testcase, passed, exit_code, std::move(dump), except_dump, start_time, end_time);
+  ret.back().kernel = std::move(kernel);
   if(testcase.persistence) {
     testcase.name += "-persistence";
-    ret.emplace_back(testcase, passed_pers, exit_code_pers, dump_pers, except_dump, start_time, end_time);
+    ret.emplace_back(testcase, passed_pers, exit_code_pers, std::move(dump_pers), except_dump, start_time, end_time);
+    ret.back().kernel = std::move(kernel_pers);
+  }
+  // a persistence pair shares one process tree; both get the same profile
+  for(auto &r : ret) {
+    r.usage = usage;
+    r.run_sec = run_sec;
+    r.check_sec = check_sec;
   }
 
   return ret;
@@ -0,0 +1,98 @@
+#include <numeric>
+
+#include "test_scheduler.h"
+
+Optional<TestOrder> parse_test_order(const String &s) {
+  if(s == "make") return TestOrder::make;
+  if(s == "timeout") return TestOrder::timeout;
+  if(s == "history") return TestOrder::history;
+  return std::nullopt;
+}
+
+const char *test_order_name(TestOrder order) {
+  switch(order) {
+    case TestOrder::make: return "make";
+    case TestOrder::timeout: return "timeout";
+    case TestOrder::history: return "history";
+  }
+  return "";
+}
+
+void order_tests(Vector<TestCase> &tests, TestOrder order, const TestHistory *history) {
+  switch(order) {
+    case TestOrder::make:
+      break;
+
+    case TestOrder::timeout:
+      std::sort(tests.rbegin(), tests.rend());
+      break;
+
+    case TestOrder::history: {
+      if(!history) break;
+      Vector<Pair<double, TestCase>> keyed;
+      keyed.reserve(tests.size());
+      for(auto &t : tests) {
+        keyed.emplace_back(history->estimate_sec(t), std::move(t));
+      }
+      std::stable_sort(keyed.begin(), keyed.end(), [](const auto &a, const auto &b) {
+        return a.first > b.first;
+      });
+      for(size_t i = 0; i < tests.size(); ++i) {
+        tests[i] = std::move(keyed[i].second);
+      }
+      break;
+    }
+  }
+}
+
+TestQueue::TestQueue(const Vector<TestCase> &target_tests, const Vector<TestCase> &persistence_tests)
+: target_tests(target_tests), persistence_tests(persistence_tests)
+, order(target_tests.size()), order_pers(persistence_tests.size())
+, next(0), next_pers(0) {
+  std::iota(order.begin(), order.end(), 0);
+  std::iota(order_pers.begin(), order_pers.end(), 0);
+}
+
+bool TestQueue::empty() const {
+  return next >= target_tests.size() && next_pers >= persistence_tests.size();
+}
+
+bool TestQueue::can_pop(bool persistence_running) const {
+  return (!persistence_running && next_pers < persistence_tests.size()) || next < target_tests.size();
+}
+
+const TestCase *TestQueue::pop(bool persistence_running) {
+  if(!persistence_running && next_pers < persistence_tests.size()) {
+    return &persistence_tests[order_pers[next_pers++]];
+  }
+  if(next < target_tests.size()) {
+    return &target_tests[order[next++]];
+  }
+  return nullptr;
+}
+
+size_t TestQueue::size() const {
+  return order.size() - next + order_pers.size() - next_pers;
+}
+
+Vector<const TestCase*> TestQueue::pending() const {
+  Vector<const TestCase*> ret;
+  for(size_t i = next_pers; i < order_pers.size(); ++i) {
+    ret.push_back(&persistence_tests[order_pers[i]]);
+  }
+  for(size_t i = next; i < order.size(); ++i) {
+    ret.push_back(&target_tests[order[i]]);
+  }
+  return ret;
+}
+
+bool TestQueue::bump(const String &full_name) {
+  const auto bump_in = [&full_name](const Vector<TestCase> &tests, Vector<size_t> &idx, size_t from) {
+    const auto it = std::find_if(idx.begin() + from, idx.end(),
+      [&](size_t i){return tests[i].full_name() == full_name;});
+    if(it == idx.end()) return false;
+    std::rotate(idx.begin() + from, it, it + 1);
+    return true;
+  };
+  return bump_in(target_tests, order, next) || bump_in(persistence_tests, order_pers, next_pers);
+}
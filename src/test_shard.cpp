@@ -0,0 +1,151 @@
+#include <iostream>
+#include <fstream>
+#include <map>
+
+#include "test_shard.h"
+#include "result_report.h"
+#include "execution.h"
+#include "string_helper.h"
+#include "termcolor/termcolor.hpp"
+
+Optional<ShardSpec> parse_shard(const String &s) {
+  unsigned index, count;
+  char rest;
+  if(std::sscanf(s.c_str(), "%u/%u%c", &index, &count, &rest) != 2) return std::nullopt;
+  if(count == 0 || index == 0 || index > count) return std::nullopt;
+  return ShardSpec{index, count};
+}
+
+Vector<double> select_shard(Vector<TestCase> &target_tests, Vector<TestCase> &persistence_tests,
+  const ShardSpec &shard, const TestHistory *history) {
+  struct Weighted {
+    double sec;
+    String name;
+    bool persistence;
+    size_t index;
+  };
+  Vector<Weighted> tests;
+  for(const auto *v : {&target_tests, &persistence_tests}) {
+    for(size_t i = 0; i < v->size(); ++i) {
+      const auto &t = (*v)[i];
+      // a persistence pair runs twice, and the history has the first run
+      const double sec = (history ? history->estimate_sec(t) : t.timeout) * (t.persistence ? 2 : 1);
+      tests.push_back(Weighted{sec, t.full_name(), t.persistence, i});
+    }
+  }
+  std::sort(tests.begin(), tests.end(), [](const Weighted &a, const Weighted &b) {
+    return a.sec != b.sec ? a.sec > b.sec : a.name < b.name;
+  });
+
+  Vector<double> loads(shard.count);
+  Vector<bool> keep_target(target_tests.size()), keep_pers(persistence_tests.size());
+  for(const auto &t : tests) {
+    const auto s = std::min_element(loads.begin(), loads.end()) - loads.begin();
+    loads[s] += t.sec;
+    if(static_cast<unsigned>(s) + 1 == shard.index) {
+      (t.persistence ? keep_pers : keep_target)[t.index] = true;
+    }
+  }
+
+  // the order within the shard stays as discovered
+  const auto filter = [](Vector<TestCase> &v, const Vector<bool> &keep) {
+    Vector<TestCase> kept;
+    for(size_t i = 0; i < v.size(); ++i) {
+      if(keep[i]) kept.push_back(std::move(v[i]));
+    }
+    v = std::move(kept);
+  };
+  filter(target_tests, keep_target);
+  filter(persistence_tests, keep_pers);
+  return loads;
+}
+
+int merge_shards(const Vector<Path> &files, const Optional<Path> &out) {
+  std::ostringstream panic_msg;
+
+  Optional<std::ofstream> merged;
+  if(out) {
+    merged.emplace(*out);
+    if(!merged->is_open()) {
+      panic_msg << "Cannot open " << *out;
+      panic(panic_msg);
+    }
+  }
+
+  struct Outcome {
+    unsigned pass, fail;
+    Vector<size_t> shards;
+    String reason;
+  };
+  std::map<String, Outcome> tests;
+  unsigned pass = 0, fail = 0;
+  double duration = 0;
+
+  std::cout << termcolor::bold << "-- Shards --" << termcolor::reset << std::endl;
+  for(size_t f = 0; f < files.size(); ++f) {
+    const auto &file = files[f];
+    std::ifstream is{file};
+    if(!is.is_open()) {
+      panic_msg << "Cannot open the shard report " << file;
+      panic(panic_msg);
+    }
+    unsigned shard_pass = 0, shard_fail = 0;
+    double shard_duration = 0;
+    String line;
+    while(std::getline(is, line)) {
+      const auto name = json_field(line, "name"), subdir = json_field(line, "subdir");
+      const auto passed = json_field(line, "passed");
+      if(!name || !subdir || !passed) continue;
+      if(merged) *merged << line << '\n';
+
+      auto &outcome = tests[*subdir + "/" + *name];
+      if(outcome.shards.empty() || outcome.shards.back() != f) outcome.shards.push_back(f);
+      const auto sec = json_field(line, "duration");
+      shard_duration += sec ? std::atof(sec->c_str()) : 0;
+      if(*passed == "true") {
+        ++outcome.pass;
+        ++shard_pass;
+      } else {
+        ++outcome.fail;
+        ++shard_fail;
+        outcome.reason = json_field(line, "reason").value_or("");
+      }
+    }
+    std::cout << String{file} << ": " << shard_pass + shard_fail << " results, "
+      << format_fixed(shard_duration, 1) << " sec of tests";
+    if(shard_fail) std::cout << termcolor::red << ", " << shard_fail << " failed" << termcolor::reset;
+    std::cout << std::endl;
+    pass += shard_pass;
+    fail += shard_fail;
+    duration += shard_duration;
+  }
+
+  // a test run by two shards means the shards disagreed on the partition
+  int return_value = fail == 0 ? 0 : 1;
+  for(const auto &[test, outcome] : tests) {
+    if(outcome.shards.size() > 1) {
+      std::cout << termcolor::yellow << test << " is in " << outcome.shards.size()
+        << " shards; were they given the same tests and history?" << termcolor::reset << std::endl;
+    }
+  }
+  if(fail) {
+    std::cout << std::endl << termcolor::red << "-- Failures --" << termcolor::reset << std::endl;
+    for(const auto &[test, outcome] : tests) {
+      if(!outcome.fail) continue;
+      std::cout << test << " (" << outcome.fail << "/" << outcome.pass + outcome.fail << ")";
+      if(!outcome.reason.empty()) {
+        std::cout << termcolor::bright_grey << " " << outcome.reason.substr(0, outcome.reason.find('\n')) << termcolor::reset;
+      }
+      std::cout << std::endl;
+    }
+  }
+  if(tests.empty()) {
+    std::cout << termcolor::red << "No results in the shard reports." << termcolor::reset << std::endl;
+    return_value = 1;
+  }
+
+  std::cout << std::endl << termcolor::bold << tests.size() << " tests in " << files.size() << " shards, "
+    << format_fixed(duration, 1) << " sec of tests" << termcolor::reset << std::endl;
+  std::cout << "Pass: " << pass << "\tFail: " << fail << std::endl;
+  return return_value;
+}
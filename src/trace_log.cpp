@@ -0,0 +1,67 @@
+#include <fstream>
+#include "execution.h"
+#include "trace_log.h"
+#include "string_helper.h"
+
+// keeps a soak run from growing the trace forever
+constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+
+TraceLog::TraceLog()
+: events(), mut()
+, origin(std::chrono::system_clock::now())
+, max_tid(0) {}
+
+void TraceLog::span(const String &name, const String &category, unsigned tid,
+  std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end,
+  String args) {
+  using namespace std::chrono;
+  std::unique_lock lock{mut};
+  if(events.size() >= MAX_TRACE_EVENTS) return;
+
+  events.push_back(Event{
+    name, category, tid,
+    duration_cast<microseconds>(start - origin).count(),
+    std::max<long long>(0, duration_cast<microseconds>(end - start).count()),
+    std::move(args)
+  });
+  max_tid = std::max(max_tid, tid);
+}
+
+void TraceLog::write(const Path &file) {
+  std::ostringstream panic_msg;
+  std::unique_lock lock{mut};
+
+  std::ofstream fs(file);
+  if(!fs.is_open()) {
+    panic_msg << "Cannot open the trace file " << file;
+    panic(panic_msg);
+  }
+
+  fs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  fs << "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"pincheck\"}}";
+  fs << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"thread_name\",\"args\":{\"name\":\"pincheck\"}}";
+  for(unsigned tid = 1; tid <= max_tid; ++tid) {
+    fs << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+      << ",\"name\":\"thread_name\",\"args\":{\"name\":\"slot " << (tid - 1) << "\"}}";
+  }
+  for(const auto &e : events) {
+    fs << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << e.tid
+      << ",\"name\":\"" << json_escape(e.name) << "\",\"cat\":\"" << json_escape(e.category) << '"'
+      << ",\"ts\":" << e.ts_us << ",\"dur\":" << e.dur_us;
+    if(!e.args.empty()) {
+      fs << ",\"args\":" << e.args;
+    }
+    fs << '}';
+  }
+  fs << "\n]}\n";
+}
+
+TraceScope::TraceScope(TraceLog *log, String name)
+: log(log), name(std::move(name))
+, start(std::chrono::system_clock::now()) {}
+
+TraceScope::~TraceScope() {
+  if(log) {
+    log->span(name, "pincheck", 0, start, std::chrono::system_clock::now());
+  }
+}
@@ -0,0 +1,88 @@
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+#include "tree_watch.h"
+#include "execution.h"
+
+constexpr uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+
+// what make and editors write besides the sources
+static bool is_ignored(const String &name) {
+  return name.empty() || name[0] == '.' || name.back() == '~' || name == "build" || name == "4913"
+    || (name.size() > 4 && (name.compare(name.size() - 4, 4, ".swp") == 0 || name.compare(name.size() - 4, 4, ".swx") == 0));
+}
+
+TreeWatch::TreeWatch(Path root)
+: fd(inotify_init1(IN_CLOEXEC | IN_NONBLOCK)), root(std::move(root)), dirs() {
+  std::ostringstream panic_msg;
+  if(fd < 0) {
+    panic_msg << "Cannot watch " << this->root << ": " << std::strerror(errno);
+    panic(panic_msg);
+  }
+  add_tree(this->root);
+}
+
+TreeWatch::~TreeWatch() noexcept {
+  close(fd);
+}
+
+void TreeWatch::add_tree(const Path &dir) {
+  const int wd = inotify_add_watch(fd, dir.c_str(), WATCH_EVENTS | IN_ONLYDIR);
+  if(wd < 0) return;
+  dirs[wd] = dir;
+
+  std::error_code ec;
+  for(fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+    if(it->is_directory(ec) && !it->is_symlink(ec) && !is_ignored(it->path().filename())) {
+      add_tree(it->path());
+    }
+  }
+}
+
+bool TreeWatch::read_events(int timeout_ms, Vector<Path> &changed) {
+  pollfd pfd{fd, POLLIN, 0};
+  if(poll(&pfd, 1, timeout_ms) <= 0) return false;
+
+  alignas(inotify_event) char buf[4096];
+  ssize_t r;
+  while((r = read(fd, buf, sizeof(buf))) > 0) {
+    for(char *p = buf; p < buf + r; ) {
+      const auto *ev = reinterpret_cast<const inotify_event*>(p);
+      p += sizeof(inotify_event) + ev->len;
+
+      const auto it = dirs.find(ev->wd);
+      if(ev->mask & IN_IGNORED) {
+        if(it != dirs.end()) dirs.erase(it);
+        continue;
+      }
+      if(it == dirs.end() || ev->len == 0) continue;
+      const String name{ev->name};
+      if(is_ignored(name)) continue;
+
+      const auto path = it->second / name;
+      if(ev->mask & IN_ISDIR) {
+        if(ev->mask & (IN_CREATE | IN_MOVED_TO)) add_tree(path);
+        continue;
+      }
+      // a created file counts once it is written and closed
+      if(ev->mask & IN_CREATE) continue;
+      changed.push_back(path.lexically_relative(root));
+    }
+  }
+  return true;
+}
+
+Vector<Path> TreeWatch::wait(Optional<std::chrono::milliseconds> timeout) {
+  Vector<Path> changed;
+  const int timeout_ms = timeout ? static_cast<int>(timeout->count()) : -1;
+  read_events(timeout_ms, changed);
+  // nothing, or only ignored files and directories
+  if(changed.empty()) return {};
+  while(read_events(static_cast<int>(WATCH_DEBOUNCE.count()), changed));
+
+  std::sort(changed.begin(), changed.end());
+  changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+  return changed;
+}
@@ -5,6 +5,8 @@
 #include "execution.h"
 #include "string_helper.h"
 
+const char *PINCHECK_VERSION = "v21.11.09";
+
 static void print_new_version(const String &new_version) {
   std::cout << termcolor::bright_magenta << termcolor::bold;
   std::cout << "New version available : " << new_version;
@@ -0,0 +1,65 @@
+// make check: what a worker accepts to run, and the hash of its cache
+#include <iostream>
+#include "remote_worker.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const String &what) {
+  if(ok) return;
+  std::cerr << "FAIL " << what << std::endl;
+  ++failures;
+}
+
+static void accepts(const String &command) {
+  expect(is_launcher_command(command), "accepts: " + command);
+}
+
+static void refuses(const String &command) {
+  expect(!is_launcher_command(command), "refuses: " + command);
+}
+
+int main() {
+  accepts("pintos -v -k -T 60 -m 20 --fs-disk=10 -p tests/userprog/args-many:args-many -- -q -f "
+    "run 'args-many a b c d' < /dev/null 2> tests/userprog/args-many.errors > tests/userprog/args-many.output");
+  accepts("pintos -v -k -T 10 -p tests/threads/alarm:alarm -- -q run alarm < /dev/null");
+  accepts("pintos -- -q run 'a; id > x'");
+
+  // redirections glued onto a word, quoted or not
+  refuses("pintos 'x'>/tmp/pwned");
+  refuses("pintos 'a'</etc/shadow");
+  refuses("pintos x>out");
+  refuses("pintos -q >'out'");
+  refuses("pintos -q 2>out");
+  refuses("pintos -q >> out");
+  // redirections to or from elsewhere
+  refuses("pintos -q > /tmp/pwned");
+  refuses("pintos -q > ../out");
+  refuses("pintos -q > 'out'");
+  refuses("pintos -q < /etc/shadow");
+  refuses("pintos -q <");
+  // paths out of the scratch directory, quoted or not
+  refuses("pintos -p /etc/shadow:x -- -q");
+  refuses("pintos -p '../../etc/shadow:x' -- -q");
+  refuses("pintos -p '/etc/shadow' -- -q");
+  // other shell
+  refuses("pintos -q; id");
+  refuses("pintos -q | id");
+  refuses("pintos -q & id");
+  refuses("pintos $(id)");
+  refuses("pintos `id`");
+  refuses("pintos \"$HOME\"");
+  refuses("pintos -q\nid");
+  refuses("pintos 'unterminated");
+  refuses("'pintos' -q");
+  refuses("sh -c pintos");
+  refuses("");
+
+  expect(content_hash("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad-3", "SHA-256 of abc");
+  expect(content_hash("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855-0", "SHA-256 of nothing");
+  expect(content_hash(String(1000, 'a')) == "41edece42d63e8d9bf515a9ba6932e1c20cbc9f5a5d134645adb5db1b9737ea3-1000",
+    "SHA-256 of 1000 bytes");
+
+  if(failures) return 1;
+  std::cout << "remote_worker: all passed" << std::endl;
+  return 0;
+}